@@ -1,14 +1,9 @@
 #include "webcam.h"
 #include <stdio.h>
 #include <stdlib.h>
-
-void my_logger(const char* msg) {
-    printf("[LIB LOG]: %s\n", msg);
-}
+#include <string.h>
 
 int main() {
-    webcam_set_logger(my_logger);
-    
     int count = 0;
     WebcamInfo* list = webcam_list_devices(&count);
     printf("Camaras encontradas: %d\n", count);
@@ -27,19 +22,36 @@ int main() {
     printf("Camara abierta. Resolucion real: %dx%d\n", 
             webcam_get_actual_width(cam), webcam_get_actual_height(cam));
 
-    WebcamFrame frame;
-    frame.data = malloc(1920 * 1080 * 3); // Reserva suficiente
+    // Buffers de salida reservados una sola vez segun el formato negociado
+    WebcamFramePool *pool = webcam_pool_create_for(cam, webcam_get_format(cam), 4,
+                                                   WEBCAM_POOL_POPULATE);
+    if (!pool) { webcam_close(cam); return 1; }
 
+    WebcamFrame frame;
     for(int i=0; i<10; i++) {
         int res = webcam_capture(cam, &frame);
         if (res == 0) {
             printf("Frame %d OK. Size: %d bytes. Time: %lu ms\n", i, frame.size, frame.timestamp_ms);
+
+            unsigned char *out = webcam_pool_acquire(pool);
+            if (out) {
+                size_t n = (size_t)frame.size;
+                if (n > webcam_pool_buffer_size(pool)) n = webcam_pool_buffer_size(pool);
+                memcpy(out, frame.data, n); // Procesar aqui...
+                webcam_pool_release(pool, out);
+            }
+            webcam_release_frame(cam);
         } else {
             printf("Error captura: %d\n", res);
         }
     }
 
-    free(frame.data);
+    WebcamPoolStats stats;
+    webcam_pool_get_stats(pool, &stats);
+    printf("Pool: %d buffers, %lu usados, %lu sin buffer libre\n",
+           stats.buffer_count, stats.acquired, stats.exhausted);
+
+    webcam_pool_destroy(pool);
     webcam_close(cam);
     return 0;
-}
\ No newline at end of file
+}
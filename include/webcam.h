@@ -8,6 +8,7 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 
 #if defined(_WIN32)
@@ -25,7 +26,19 @@ typedef enum {
     WEBCAM_FMT_RGB32  = 1,  // 4 bytes: R, G, B, A
     WEBCAM_FMT_YUYV   = 2,  // 2 bytes: Y0, U, Y1, V
     WEBCAM_FMT_YUV420 = 3,  // 1.5 bytes: Y plane + U plane + V plane
-    WEBCAM_FMT_MJPEG  = 4   // Compressed JPEG
+    WEBCAM_FMT_MJPEG  = 4,  // Compressed JPEG
+    WEBCAM_FMT_NV12   = 5,  // 1.5 bytes: Y plane + interleaved UV plane
+    WEBCAM_FMT_GRAY8  = 6,  // 1 byte: Y only
+    // Raw Bayer mosaics, named by the 2x2 cell's first two rows. 8-bit formats
+    // use 1 byte per pixel, 10-bit ones 2 bytes (little-endian, low 10 bits)
+    WEBCAM_FMT_SRGGB8  = 7,
+    WEBCAM_FMT_SBGGR8  = 8,
+    WEBCAM_FMT_SGRBG8  = 9,
+    WEBCAM_FMT_SGBRG8  = 10,
+    WEBCAM_FMT_SRGGB10 = 11,
+    WEBCAM_FMT_SBGGR10 = 12,
+    WEBCAM_FMT_SGRBG10 = 13,
+    WEBCAM_FMT_SGBRG10 = 14
 } WebcamPixelFormat;
 
 typedef struct Webcam Webcam;
@@ -38,6 +51,8 @@ typedef struct {
     int size;
     WebcamPixelFormat format;
     unsigned long timestamp_ms;
+    uint64_t timestamp_us;      // Monotonic capture time (kernel timestamp on Linux)
+    uint32_t control_generation; // Newest control change applied before capture
 } WebcamFrame;
 
 typedef struct {
@@ -50,7 +65,7 @@ typedef struct {
     WebcamPixelFormat format;
     int width;
     int height;
-    int fps;
+    int fps;                    // 0 if the driver does not report it
 } WebcamFormatInfo;
 
 typedef struct {
@@ -62,6 +77,128 @@ typedef struct {
     int min_height;
 } WebcamCapabilities;
 
+typedef struct WebcamStreamServer WebcamStreamServer;
+
+typedef struct {
+    int clients;                   // Connected viewers
+    unsigned long frames_published;
+    unsigned long frames_sent;     // Parts fully written to any client
+    unsigned long frames_skipped;  // Superseded before a viewer was ready
+    unsigned long spills;          // Slow viewers that fell back to a copy
+} WebcamStreamStats;
+
+#define WEBCAM_MOSAIC_MAX_TILES 64
+
+typedef struct WebcamMosaic WebcamMosaic;
+
+typedef struct WebcamHistory WebcamHistory;
+
+// Runs on the history's delivery thread once per snapshot frame, oldest first;
+// frame->data is only valid during the call
+typedef void (*WebcamHistoryCallback)(void *user, const WebcamFrame *frame, int index, int count);
+
+typedef struct {
+    int frames;                    // Frames in the window
+    uint64_t span_us;              // Newest minus oldest capture timestamp
+    size_t bytes_used;
+    size_t memory_bytes;           // Budget, plus scratch grown past the camera's frames
+    unsigned long pushed;
+    unsigned long dropped;         // Larger than the budget, or room pinned by a snapshot
+    unsigned long snapshots;       // Snapshots fully delivered
+    uint64_t input_bytes;          // Stored frames before / after coding
+    uint64_t stored_bytes;
+    int delivering;                // A snapshot is still being delivered
+} WebcamHistoryStats;
+
+#define WEBCAM_SYNC_MAX_CAMERAS 16
+
+typedef struct WebcamSyncGroup WebcamSyncGroup;
+
+// Frames from every camera of a sync group, exposed within the tolerance window
+typedef struct {
+    int count;
+    WebcamFrame frames[WEBCAM_SYNC_MAX_CAMERAS];
+    uint64_t timestamp_us;      // Earliest frame of the set
+    uint64_t skew_us;           // Latest minus earliest
+} WebcamFrameSet;
+
+typedef struct {
+    unsigned long sets;
+    unsigned long unmatched;    // Frames dropped for lack of partners
+    unsigned long timeouts;
+    uint64_t last_skew_us;
+    uint64_t max_skew_us;
+    uint64_t mean_skew_us;
+} WebcamSyncStats;
+
+typedef enum {
+    WEBCAM_TENSOR_U8_NHWC  = 0,     // uint8, H x W x 3
+    WEBCAM_TENSOR_F32_NHWC = 1,     // float32, H x W x 3, normalized
+    WEBCAM_TENSOR_F32_NCHW = 2      // float32, 3 x H x W, normalized
+} WebcamTensorLayout;
+
+typedef enum {
+    WEBCAM_FIT_STRETCH     = 0,
+    WEBCAM_FIT_LETTERBOX   = 1,     // Keep aspect ratio, pad the borders
+    WEBCAM_FIT_CENTER_CROP = 2      // Keep aspect ratio, crop the center
+} WebcamFitMode;
+
+typedef struct {
+    int width;
+    int height;
+    WebcamTensorLayout layout;
+    WebcamFitMode fit;
+    int bgr;                        // Emit B, G, R instead of R, G, B
+    float mean[3];                  // R, G, B: float = (pixel / 255 - mean) / std
+    float std[3];
+    unsigned char pad_value;        // Letterbox fill, before normalization
+} WebcamTensorSpec;
+
+// Maps source pixel coordinates to tensor coordinates: t = s * scale + offset
+typedef struct {
+    float scale_x, scale_y;
+    float offset_x, offset_y;
+} WebcamTensorMap;
+
+typedef struct WebcamJpegEncoder WebcamJpegEncoder;
+typedef struct WebcamJpegDecoder WebcamJpegDecoder;
+
+typedef struct WebcamFramePool WebcamFramePool;
+
+// Pool flags
+#define WEBCAM_POOL_HUGEPAGES 0x1   // Back buffers with huge pages when available
+#define WEBCAM_POOL_POPULATE  0x2   // Pre-fault every page at creation
+#define WEBCAM_POOL_LOCK      0x4   // mlock the region (implies POPULATE)
+
+typedef struct {
+    int buffer_count;
+    int in_use;
+    size_t buffer_size;
+    int hugepages;                 // 1 if the region really is on huge pages
+    int locked;                    // 1 if the region really is locked in RAM
+    unsigned long acquired;
+    unsigned long exhausted;       // acquire() calls that found the pool empty
+} WebcamPoolStats;
+
+// Real-time profile. Each part is opt-in; zero fields leave things as they are.
+typedef struct {
+    uint64_t cpu_mask;              // Bit n = CPU n; workers are spread one per CPU
+    int priority;                   // SCHED_FIFO 1-99 (time-critical on Windows),
+                                    // < 0 back to the default policy
+    int lock_memory;                // mlock the camera's mapped buffers (Linux)
+} WebcamRtProfile;
+
+// Wakeup latency: driver timestamp to dequeue, over the frames a capture
+// call had to wait for (frames already queued on entry are not counted)
+typedef struct {
+    unsigned long samples;
+    uint64_t min_us;
+    uint64_t mean_us;
+    uint64_t p99_us;                // Within 1/4 octave (histogram bucket)
+    uint64_t max_us;
+    int start_of_exposure;          // Driver stamps exposure start: readout included
+} WebcamLatencyStats;
+
 typedef enum {
     WEBCAM_PARAM_BRIGHTNESS = 1,
     WEBCAM_PARAM_CONTRAST   = 2,
@@ -70,9 +207,27 @@ typedef enum {
     WEBCAM_PARAM_FOCUS      = 5,
     WEBCAM_PARAM_ZOOM       = 6,
     WEBCAM_PARAM_GAIN       = 7,
-    WEBCAM_PARAM_SHARPNESS  = 8
+    WEBCAM_PARAM_SHARPNESS  = 8,
+    WEBCAM_PARAM_HFLIP      = 9,    // Sensor/driver mirroring (0 or 1)
+    WEBCAM_PARAM_VFLIP      = 10
 } WebcamParameter;
 
+typedef enum {
+    WEBCAM_ROTATE_0   = 0,
+    WEBCAM_ROTATE_90  = 1,          // Clockwise
+    WEBCAM_ROTATE_180 = 2,
+    WEBCAM_ROTATE_270 = 3,
+    WEBCAM_FLIP_H     = 4,          // Mirror left <-> right
+    WEBCAM_FLIP_V     = 5,          // Mirror top <-> bottom
+    WEBCAM_TRANSPOSE  = 6           // Swap rows and columns
+} WebcamOrientation;
+
+typedef enum {
+    WEBCAM_DEMOSAIC_BILINEAR = 0,   // Fastest full-resolution mode
+    WEBCAM_DEMOSAIC_EDGE     = 1,   // Edge-directed green, fewer zipper artifacts
+    WEBCAM_DEMOSAIC_HALF     = 2    // 2x2 binning at half resolution
+} WebcamDemosaicMode;
+
 // Device enumeration
 WEBCAM_API WebcamInfo* webcam_list_devices(int *count);
 WEBCAM_API void webcam_free_list(WebcamInfo *list);
@@ -87,22 +242,187 @@ WEBCAM_API WebcamFormatInfo* webcam_find_best_format(
     WebcamPixelFormat preferred_format
 );
 
+// Bytes needed for one frame (upper bound for MJPEG)
+WEBCAM_API size_t webcam_frame_size(WebcamPixelFormat format, int width, int height);
+
 // Camera lifecycle (ZERO-COPY ONLY)
 WEBCAM_API Webcam* webcam_open(int width, int height, int device_index, 
                                WebcamPixelFormat format);
-WEBCAM_API int webcam_capture(Webcam *cam, WebcamFrame *frame);
+// Same, asking the driver for fps frames per second (<= 0: driver default)
+WEBCAM_API Webcam* webcam_open_fps(int width, int height, int device_index,
+                                   WebcamPixelFormat format, int fps);
+WEBCAM_API int webcam_capture(Webcam *cam, WebcamFrame *frame);  // 2 s timeout
+// -2 when no frame is ready (would block) instead of waiting; for event loops
+// polling webcam_get_fd()
+WEBCAM_API int webcam_try_capture(Webcam *cam, WebcamFrame *frame);
+// timeout_us < 0 waits forever, 0 never waits; -2 on timeout
+WEBCAM_API int webcam_capture_timeout(Webcam *cam, WebcamFrame *frame, long timeout_us);
 WEBCAM_API void webcam_release_frame(Webcam *cam);
+WEBCAM_API void webcam_return_frame(Webcam *cam, const WebcamFrame *frame); // When holding several
 WEBCAM_API void webcam_close(Webcam *cam);
 
 // Information
 WEBCAM_API int webcam_get_actual_width(Webcam *cam);
 WEBCAM_API int webcam_get_actual_height(Webcam *cam);
 WEBCAM_API WebcamPixelFormat webcam_get_format(Webcam *cam);
+WEBCAM_API int webcam_get_fd(Webcam *cam); // Pollable device fd, -1 if none (Windows)
 
-// Controls
+// Frame rate. The driver picks the closest rate it supports; on Linux the
+// stream is restarted if needed, so no frame may be held. 0 = unknown.
+WEBCAM_API int webcam_set_fps(Webcam *cam, int fps);
+WEBCAM_API int webcam_get_fps(Webcam *cam);
+// Delivers only every Nth frame and at most max_fps frames per second
+// (1, 0 = all). Dropped frames go back to the driver inside webcam_capture().
+WEBCAM_API int webcam_set_decimation(Webcam *cam, int every_nth, int max_fps);
+
+// Controls. Safe from any thread while another one captures: changes go
+// through a lock-free queue and are applied in order, by the setter when it
+// can or else at the next capture, which never waits for them. Each applied
+// change is a new generation, reported in WebcamFrame.control_generation.
 WEBCAM_API long webcam_get_parameter(Webcam *cam, WebcamParameter param);
+// Queue and wait until applied (by this or the draining thread): -1 if the
+// driver rejected it, -2 if the queue is full
 WEBCAM_API int webcam_set_parameter(Webcam *cam, WebcamParameter param, long value);
 WEBCAM_API int webcam_set_auto(Webcam *cam, WebcamParameter param, int is_auto);
+// Queue only, for latency-sensitive threads; generation (optional) receives
+// the change's generation. -2 if the queue is full.
+WEBCAM_API int webcam_queue_parameter(Webcam *cam, WebcamParameter param, long value,
+                                      uint32_t *generation);
+WEBCAM_API int webcam_queue_auto(Webcam *cam, WebcamParameter param, int is_auto,
+                                 uint32_t *generation);
+// Newest applied generation (0 before the first change)
+WEBCAM_API uint32_t webcam_get_control_generation(Webcam *cam);
+
+// Conversion, crop and bilinear scale to RGB24/RGB32 (MJPEG not supported).
+// Rows are split across the camera's worker threads; output does not depend on
+// the thread count. cam may be NULL to run on the calling thread only.
+// Transforms may run concurrently on one camera (a job that finds the pool busy
+// runs on its own thread), but webcam_set_threads() replaces the pool and must
+// not race with any of them.
+WEBCAM_API int webcam_set_threads(Webcam *cam, int threads);
+WEBCAM_API int webcam_get_threads(Webcam *cam);
+// Real-time profile for the camera's worker threads, kept for threads created
+// later by webcam_set_threads(). Not for the capture thread: that is the
+// caller's, see webcam_set_thread_rt(). -1 if any part was refused (EPERM
+// without CAP_SYS_NICE / RLIMIT_MEMLOCK); the rest is still applied.
+WEBCAM_API int webcam_set_rt_profile(Webcam *cam, const WebcamRtProfile *profile);
+// Same for the calling thread (lock_memory ignored); whole cpu_mask allowed
+WEBCAM_API int webcam_set_thread_rt(const WebcamRtProfile *profile);
+// Safe to call while another thread captures; reset clears after reading.
+// -1 where the backend has no driver timestamps (Windows).
+WEBCAM_API int webcam_get_latency_stats(Webcam *cam, WebcamLatencyStats *stats, int reset);
+WEBCAM_API int webcam_convert(Webcam *cam, const WebcamFrame *src, unsigned char *dst,
+                              WebcamPixelFormat dst_format);
+WEBCAM_API int webcam_crop(Webcam *cam, const WebcamFrame *src, int x, int y,
+                           int width, int height, unsigned char *dst,
+                           WebcamPixelFormat dst_format);
+WEBCAM_API int webcam_scale(Webcam *cam, const WebcamFrame *src, unsigned char *dst,
+                            int dst_width, int dst_height, WebcamPixelFormat dst_format);
+
+// Rotate/flip/transpose into dst, keeping the source pixel format.
+// dst needs webcam_frame_size(src->format, w, h) bytes; out (optional)
+// describes the result (width and height swap for 90/270/transpose).
+WEBCAM_API int webcam_orient(Webcam *cam, const WebcamFrame *src, WebcamOrientation op,
+                             unsigned char *dst, WebcamFrame *out);
+// Lets the driver flip/mirror when it can; returns what is left to do with
+// webcam_orient() (WEBCAM_ROTATE_0 when the driver does everything).
+WEBCAM_API WebcamOrientation webcam_set_orientation(Webcam *cam, WebcamOrientation op);
+
+// Baseline JPEG encoder: YUYV as 4:2:2, YUV420/NV12/RGB as 4:2:0, GRAY8 as
+// one component, read in place. Not thread-safe per encoder; cam (optional) supplies worker threads.
+WEBCAM_API WebcamJpegEncoder* webcam_jpeg_create(Webcam *cam, int quality);
+WEBCAM_API int webcam_jpeg_set_quality(WebcamJpegEncoder *enc, int quality);
+// Returns -1 if dst is too small (or NULL); *out_size then holds the size needed
+WEBCAM_API int webcam_jpeg_encode(WebcamJpegEncoder *enc, const WebcamFrame *src,
+                                  unsigned char *dst, size_t dst_size, size_t *out_size);
+WEBCAM_API void webcam_jpeg_destroy(WebcamJpegEncoder *enc);
+
+// Scaled MJPEG decoder for previews: scale 1, 2, 4 or 8 (1/8 reads only DC
+// terms) into GRAY8 or YUV420 (dimensions rounded up to even). Output is
+// ceil(width / scale) x ceil(height / scale). Returns -1 if dst is too small
+// (or NULL); out then holds the dimensions and size needed.
+WEBCAM_API WebcamJpegDecoder* webcam_jpeg_decoder_create(void);
+WEBCAM_API int webcam_jpeg_decode(WebcamJpegDecoder *dec, const WebcamFrame *src, int scale,
+                                  WebcamPixelFormat dst_format, unsigned char *dst,
+                                  size_t dst_size, WebcamFrame *out);
+WEBCAM_API void webcam_jpeg_decoder_destroy(WebcamJpegDecoder *dec);
+
+// Bayer demosaic into RGB24 or RGB32. Width and height must be even; HALF
+// bins each 2x2 cell into one pixel (width / 2 x height / 2) for previews.
+// webcam_convert() and friends also accept Bayer input (bilinear).
+WEBCAM_API int webcam_demosaic(Webcam *cam, const WebcamFrame *src, WebcamDemosaicMode mode,
+                               unsigned char *dst, WebcamPixelFormat dst_format,
+                               WebcamFrame *out);
+
+// Fused resize + color conversion + normalization into a caller-provided tensor.
+// map (optional) receives the source -> tensor transform.
+WEBCAM_API int webcam_preprocess(Webcam *cam, const WebcamFrame *src,
+                                 const WebcamTensorSpec *spec, void *dst,
+                                 WebcamTensorMap *map);
+
+// Output buffer pool: 64-byte aligned, allocated once, lock-free acquire/release
+WEBCAM_API WebcamFramePool* webcam_pool_create(size_t buffer_size, int count, int flags);
+WEBCAM_API WebcamFramePool* webcam_pool_create_for(Webcam *cam, WebcamPixelFormat format,
+                                                   int count, int flags);
+WEBCAM_API unsigned char* webcam_pool_acquire(WebcamFramePool *pool);
+WEBCAM_API void webcam_pool_release(WebcamFramePool *pool, unsigned char *buffer);
+WEBCAM_API size_t webcam_pool_buffer_size(WebcamFramePool *pool);
+WEBCAM_API void webcam_pool_get_stats(WebcamFramePool *pool, WebcamPoolStats *stats);
+WEBCAM_API void webcam_pool_destroy(WebcamFramePool *pool);
+
+// Synchronized multi-camera capture (Linux). The group owns capture and release
+// for its cameras; do not call webcam_capture/webcam_release_frame on them.
+WEBCAM_API WebcamSyncGroup* webcam_sync_create(Webcam **cams, int count, int tolerance_us);
+// timeout_ms < 0 waits forever; -2 on timeout
+WEBCAM_API int webcam_sync_capture(WebcamSyncGroup *group, WebcamFrameSet *set, int timeout_ms);
+WEBCAM_API void webcam_sync_release(WebcamSyncGroup *group, WebcamFrameSet *set);
+WEBCAM_API void webcam_sync_get_stats(WebcamSyncGroup *group, WebcamSyncStats *stats);
+WEBCAM_API void webcam_sync_destroy(WebcamSyncGroup *group);
+
+// MJPEG-over-HTTP streaming (Linux). Publish between capture and release;
+// the server keeps its own reference to the buffer, so release as usual.
+// webcam_stream_start listens on 127.0.0.1 only; webcam_stream_start_on takes
+// an IPv4 address to bind ("0.0.0.0" = every interface, NULL = loopback).
+WEBCAM_API WebcamStreamServer* webcam_stream_start(Webcam *cam, int port,
+                                                   int max_clients, int max_fps);
+WEBCAM_API WebcamStreamServer* webcam_stream_start_on(Webcam *cam, const char *address, int port,
+                                                      int max_clients, int max_fps);
+WEBCAM_API int webcam_stream_publish(WebcamStreamServer *srv, const WebcamFrame *frame);
+WEBCAM_API void webcam_stream_get_stats(WebcamStreamServer *srv, WebcamStreamStats *stats);
+WEBCAM_API void webcam_stream_stop(WebcamStreamServer *srv);
+
+// Multi-camera mosaic: count tiles in a grid of cols columns (0 = square-ish)
+// over one width x height RGB24/RGB32 image owned by the mosaic. cams may be
+// NULL, or hold NULL entries, for tiles fed with webcam_mosaic_update().
+WEBCAM_API WebcamMosaic* webcam_mosaic_create(Webcam **cams, int count, int width, int height,
+                                              int cols, WebcamPixelFormat format);
+// Takes the newest ready frame of every camera (never waits on Linux) and
+// redraws only those tiles; returns how many were redrawn. The mosaic owns
+// capture and release for its cameras.
+WEBCAM_API int webcam_mosaic_render(WebcamMosaic *m);
+// Draws a frame (any format, MJPEG included) into tile index
+WEBCAM_API int webcam_mosaic_update(WebcamMosaic *m, int index, const WebcamFrame *frame);
+// Describes the output image; it is redrawn in place by render/update
+WEBCAM_API int webcam_mosaic_get_frame(WebcamMosaic *m, WebcamFrame *out);
+WEBCAM_API void webcam_mosaic_destroy(WebcamMosaic *m);
+
+// Pre-event history: the last window_ms of frames (0 = as many as fit) in a
+// fixed memory_bytes ring. MJPEG is kept as-is, raw formats are coded
+// losslessly, or scaled down by raw_scale (> 1) to RGB24 first. Entry slots
+// and the coding scratch for cam's current geometry come out of memory_bytes;
+// with cam NULL or larger frames the scratch grows on top of it (reported in
+// stats). Push from the capture thread before releasing the frame; -2 if it
+// could not be stored.
+WEBCAM_API WebcamHistory* webcam_history_create(Webcam *cam, size_t memory_bytes,
+                                                int window_ms, int raw_scale);
+WEBCAM_API int webcam_history_push(WebcamHistory *h, const WebcamFrame *frame);
+// Hands the last pre_ms (<= 0: whole window) to callback on a background
+// thread and returns the number of frames it will see; -2 while the previous
+// snapshot is still being delivered. Capture keeps running meanwhile.
+WEBCAM_API int webcam_history_trigger(WebcamHistory *h, int pre_ms,
+                                      WebcamHistoryCallback callback, void *user);
+WEBCAM_API void webcam_history_get_stats(WebcamHistory *h, WebcamHistoryStats *stats);
+WEBCAM_API void webcam_history_destroy(WebcamHistory *h);
 
 #ifdef __cplusplus
 }
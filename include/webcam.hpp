@@ -0,0 +1,345 @@
+// ============================================================================
+// webcam.hpp - Header-only C++17 wrapper (RAII, move-only frame leases)
+// ============================================================================
+// A Frame owns one captured buffer and hands it back to the driver when it is
+// destroyed, so frames can move across pipeline stages without copies and
+// without manual webcam_release_frame() calls. Frames share ownership of the
+// device with their Camera, so it is only closed once the Camera and every
+// Frame taken from it are gone; a Frame may outlive its Camera object.
+//
+// On Linux several Frames per Camera may be alive at once (up to the number of
+// driver buffers minus one). On Windows only one Frame may be alive at a time.
+//
+// With C++20 coroutines, `co_await camera.next_frame(loop)` suspends until a
+// frame can be taken without blocking. `loop` is any object providing
+//     void wait_readable(int fd, std::coroutine_handle<> h);
+// that resumes `h` once `fd` is readable (epoll, io_uring, libuv, asio...).
+// A readable fd may still yield no frame (decimation, spurious wakeups); the
+// awaiter then waits again, so the loop thread never blocks on a capture.
+// ============================================================================
+#ifndef WEBCAM_HPP
+#define WEBCAM_HPP
+
+#include "webcam.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+  #include <coroutine>
+  #define WEBCAM_HAS_COROUTINES 1
+#endif
+
+#if defined(__cpp_lib_span) || (__cplusplus >= 202002L && __has_include(<span>))
+  #include <span>
+  #define WEBCAM_HAS_STD_SPAN 1
+#endif
+
+namespace webcam {
+
+class Error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+#ifdef WEBCAM_HAS_STD_SPAN
+template <class T> using Span = std::span<T>;
+#else
+// Minimal std::span stand-in for C++17
+template <class T>
+class Span {
+public:
+    constexpr Span() noexcept = default;
+    constexpr Span(T *data, std::size_t size) noexcept : data_(data), size_(size) {}
+
+    constexpr T* data() const noexcept { return data_; }
+    constexpr std::size_t size() const noexcept { return size_; }
+    constexpr std::size_t size_bytes() const noexcept { return size_ * sizeof(T); }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+    constexpr T& operator[](std::size_t i) const noexcept { return data_[i]; }
+    constexpr T* begin() const noexcept { return data_; }
+    constexpr T* end() const noexcept { return data_ + size_; }
+    constexpr Span subspan(std::size_t offset, std::size_t count) const noexcept {
+        return Span(data_ + offset, count);
+    }
+
+private:
+    T *data_ = nullptr;
+    std::size_t size_ = 0;
+};
+#endif
+
+struct Plane {
+    Span<const std::uint8_t> data;
+    int stride;                 // Bytes per row (0 for compressed data)
+    int width;
+    int height;
+};
+
+class Camera;
+
+// Closes the device when its last owner (Camera or Frame) goes away
+using Device = std::shared_ptr<Webcam>;
+
+// Move-only lease on a captured buffer
+class Frame {
+public:
+    Frame() noexcept = default;
+    ~Frame() { reset(); }
+
+    Frame(const Frame&) = delete;
+    Frame& operator=(const Frame&) = delete;
+
+    Frame(Frame &&other) noexcept : cam_(std::move(other.cam_)), frame_(other.frame_) {}
+
+    Frame& operator=(Frame &&other) noexcept {
+        if (this != &other) {
+            reset();
+            cam_ = std::move(other.cam_);
+            frame_ = other.frame_;
+        }
+        return *this;
+    }
+
+    // Return the buffer to the driver now (and close the device if its
+    // Camera is already gone)
+    void reset() noexcept {
+        if (cam_) webcam_return_frame(cam_.get(), &frame_);
+        cam_.reset();
+    }
+
+    explicit operator bool() const noexcept { return cam_ != nullptr; }
+
+    const WebcamFrame& raw() const noexcept { return frame_; }
+    int width() const noexcept { return frame_.width; }
+    int height() const noexcept { return frame_.height; }
+    WebcamPixelFormat format() const noexcept { return frame_.format; }
+    std::uint64_t timestamp_us() const noexcept { return frame_.timestamp_us; }
+    std::uint32_t control_generation() const noexcept { return frame_.control_generation; }
+
+    Span<const std::uint8_t> bytes() const noexcept {
+        return Span<const std::uint8_t>(frame_.data, cam_ ? (std::size_t)frame_.size : 0);
+    }
+
+    int plane_count() const noexcept {
+        if (frame_.format == WEBCAM_FMT_YUV420) return 3;
+        return frame_.format == WEBCAM_FMT_NV12 ? 2 : 1;
+    }
+
+    Plane plane(int index) const noexcept {
+        const int w = frame_.width, h = frame_.height;
+        switch (frame_.format) {
+            case WEBCAM_FMT_RGB24:  return whole(w * 3);
+            case WEBCAM_FMT_RGB32:  return whole(w * 4);
+            case WEBCAM_FMT_YUYV:   return whole(w * 2);
+            case WEBCAM_FMT_GRAY8:
+            case WEBCAM_FMT_SRGGB8:
+            case WEBCAM_FMT_SBGGR8:
+            case WEBCAM_FMT_SGRBG8:
+            case WEBCAM_FMT_SGBRG8:  return whole(w);
+            case WEBCAM_FMT_SRGGB10:
+            case WEBCAM_FMT_SBGGR10:
+            case WEBCAM_FMT_SGRBG10:
+            case WEBCAM_FMT_SGBRG10: return whole(w * 2);
+            case WEBCAM_FMT_YUV420: {
+                const std::size_t luma = (std::size_t)w * h;
+                const std::size_t chroma = (std::size_t)(w / 2) * (h / 2);
+                if (index == 0) return { bytes().subspan(0, luma), w, w, h };
+                const std::size_t offset = luma + (index == 2 ? chroma : 0);
+                return { bytes().subspan(offset, chroma), w / 2, w / 2, h / 2 };
+            }
+            case WEBCAM_FMT_NV12: {
+                const std::size_t luma = (std::size_t)w * h;
+                if (index == 0) return { bytes().subspan(0, luma), w, w, h };
+                return { bytes().subspan(luma, luma / 2), w, w / 2, h / 2 };
+            }
+            default:                return { bytes(), 0, w, h };
+        }
+    }
+
+private:
+    friend class Camera;
+    Frame(Device cam, const WebcamFrame &frame) noexcept : cam_(std::move(cam)), frame_(frame) {}
+
+    Plane whole(int stride) const noexcept {
+        return { bytes(), stride, frame_.width, frame_.height };
+    }
+
+    Device cam_;
+    WebcamFrame frame_ = {};
+};
+
+#ifdef WEBCAM_HAS_COROUTINES
+template <class Loop> class NextFrame;
+#endif
+
+class Camera {
+public:
+    Camera(int width, int height, int device_index = 0,
+           WebcamPixelFormat format = WEBCAM_FMT_YUYV, int fps = 0)
+        : dev_(open(width, height, device_index, format, fps)), cam_(dev_.get()) {}
+
+    Camera(const Camera&) = delete;
+    Camera& operator=(const Camera&) = delete;
+
+    Camera(Camera &&other) noexcept : dev_(std::move(other.dev_)), cam_(other.cam_) {
+        other.cam_ = nullptr;
+    }
+
+    Camera& operator=(Camera &&other) noexcept {
+        if (this != &other) {
+            dev_ = std::move(other.dev_);
+            cam_ = other.cam_;
+            other.cam_ = nullptr;
+        }
+        return *this;
+    }
+
+    static std::vector<WebcamInfo> list_devices() {
+        int count = 0;
+        WebcamInfo *list = webcam_list_devices(&count);
+        std::vector<WebcamInfo> devices(list, list + (list ? count : 0));
+        webcam_free_list(list);
+        return devices;
+    }
+
+    // Empty Frame on timeout; throws on device errors
+    Frame capture() {
+        WebcamFrame frame;
+        int r = webcam_capture(cam_, &frame);
+        if (r == -2) return Frame();
+        if (r != 0) throw Error("webcam: capture failed");
+        return Frame(dev_, frame);
+    }
+
+    // Empty Frame if none is ready (or on timeout); timeout < 0 waits forever
+    Frame try_capture() { return capture_for(std::chrono::microseconds(0)); }
+    Frame capture_for(std::chrono::microseconds timeout) {
+        WebcamFrame frame;
+        int r = webcam_capture_timeout(cam_, &frame, static_cast<long>(timeout.count()));
+        if (r == -2) return Frame();
+        if (r != 0) throw Error("webcam: capture failed");
+        return Frame(dev_, frame);
+    }
+
+#ifdef WEBCAM_HAS_COROUTINES
+    template <class Loop>
+    NextFrame<Loop> next_frame(Loop &loop) noexcept { return NextFrame<Loop>(*this, loop); }
+#endif
+
+    int width() const noexcept { return webcam_get_actual_width(cam_); }
+    int height() const noexcept { return webcam_get_actual_height(cam_); }
+    WebcamPixelFormat format() const noexcept { return webcam_get_format(cam_); }
+    int fd() const noexcept { return webcam_get_fd(cam_); }
+    int fps() const noexcept { return webcam_get_fps(cam_); }
+
+    bool set_fps(int fps) noexcept { return webcam_set_fps(cam_, fps) == 0; }
+    bool set_decimation(int every_nth, int max_fps = 0) noexcept {
+        return webcam_set_decimation(cam_, every_nth, max_fps) == 0;
+    }
+
+    long get(WebcamParameter param) const noexcept { return webcam_get_parameter(cam_, param); }
+    bool set(WebcamParameter param, long value) noexcept {
+        return webcam_set_parameter(cam_, param, value) == 0;
+    }
+    bool set_auto(WebcamParameter param, bool is_auto) noexcept {
+        return webcam_set_auto(cam_, param, is_auto ? 1 : 0) == 0;
+    }
+
+    // Thread-safe, never blocks: the change's generation, or 0 if the queue
+    // is full (or the parameter invalid)
+    std::uint32_t queue(WebcamParameter param, long value) noexcept {
+        std::uint32_t gen = 0;
+        return webcam_queue_parameter(cam_, param, value, &gen) == 0 ? gen : 0;
+    }
+    std::uint32_t queue_auto(WebcamParameter param, bool is_auto) noexcept {
+        std::uint32_t gen = 0;
+        return webcam_queue_auto(cam_, param, is_auto ? 1 : 0, &gen) == 0 ? gen : 0;
+    }
+    std::uint32_t control_generation() const noexcept { return webcam_get_control_generation(cam_); }
+
+    Webcam* native_handle() const noexcept { return cam_; }
+
+private:
+    static Device open(int width, int height, int device_index, WebcamPixelFormat format, int fps) {
+        Webcam *cam = webcam_open_fps(width, height, device_index, format, fps);
+        if (!cam) throw Error("webcam: cannot open device " + std::to_string(device_index));
+        return Device(cam, webcam_close);
+    }
+
+    Device dev_;
+    Webcam *cam_;               // dev_.get(), for the C calls
+};
+
+#ifdef WEBCAM_HAS_COROUTINES
+namespace detail {
+// Eager, self-destroying coroutine that drives the wait loop below
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+} // namespace detail
+
+template <class Loop>
+class NextFrame {
+public:
+    NextFrame(Camera &cam, Loop &loop) noexcept : cam_(&cam), loop_(&loop) {}
+
+    // Without a pollable fd (Windows) it does not suspend: the Frame is empty
+    // if none is ready yet
+    bool await_ready() {
+        if (cam_->fd() >= 0) return false;
+        frame_ = cam_->try_capture();
+        return true;
+    }
+    void await_suspend(std::coroutine_handle<> h) { wait(h); }
+    Frame await_resume() {
+        if (error_) std::rethrow_exception(error_);
+        return std::move(frame_);
+    }
+
+private:
+    struct Readable {
+        Loop *loop;
+        int fd;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { loop->wait_readable(fd, h); }
+        void await_resume() const noexcept {}
+    };
+
+    // Re-arms the wait until a frame is actually taken, then resumes h.
+    // Nothing here touches *this after h.resume(), which may destroy it.
+    detail::Detached wait(std::coroutine_handle<> h) {
+        for (;;) {
+            co_await Readable{loop_, cam_->fd()};
+            try {
+                frame_ = cam_->try_capture();
+            } catch (...) {
+                error_ = std::current_exception();
+            }
+            if (frame_ || error_) break;
+        }
+        h.resume();
+    }
+
+    Camera *cam_;
+    Loop *loop_;
+    Frame frame_;
+    std::exception_ptr error_;
+};
+#endif
+
+} // namespace webcam
+
+#endif // WEBCAM_HPP
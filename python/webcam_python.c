@@ -0,0 +1,590 @@
+// ============================================================================
+// webcam_python.c - CPython extension module `webcam`
+// ============================================================================
+// Frames are leases on the driver buffer, exposed without copies through the
+// buffer protocol (and __array_interface__), so numpy.asarray(frame) is a view
+// over the mmap'd memory. The lease is handed back by release() / the end of a
+// `with` block; while views still exist the hand-back is deferred until the
+// last one is gone, so a view can never outlive its buffer.
+//
+// capture() drops the GIL while it waits, so one thread per camera streams in
+// parallel. A Camera must not be captured from two threads at once.
+// ============================================================================
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include "webcam.h"
+
+typedef struct {
+    PyObject_HEAD
+    Webcam *cam;
+    int capturing;              // A capture is running without the GIL
+    int calls;                  // Calls of any kind running without the GIL
+    int leases;                 // Frames not yet handed back
+} CameraObject;
+
+typedef struct {
+    PyObject_HEAD
+    CameraObject *camera;       // NULL once handed back
+    WebcamFrame frame;
+    int exports;                // Live buffer views
+    int release_pending;
+    int ndim;
+    Py_ssize_t shape[3];
+    Py_ssize_t itemsize;
+    const char *format;         // struct-module code, "B" or "<H"
+    const char *typestr;        // numpy code, "|u1" or "<u2"
+} FrameObject;
+
+static PyTypeObject CameraType;
+static PyTypeObject FrameType;
+
+// ============================================================================
+// Frame
+// ============================================================================
+
+// Element layout per format: rows x columns (x channels), as OpenCV lays them out
+static void frame_layout(FrameObject *f) {
+    const WebcamFrame *fr = &f->frame;
+    Py_ssize_t w = fr->width, h = fr->height;
+    f->itemsize = 1;
+    f->format = "B";
+    f->typestr = "|u1";
+    f->ndim = 2;
+    f->shape[0] = h;
+    f->shape[1] = w;
+    switch (fr->format) {
+        case WEBCAM_FMT_RGB24: f->ndim = 3; f->shape[2] = 3; break;
+        case WEBCAM_FMT_RGB32: f->ndim = 3; f->shape[2] = 4; break;
+        case WEBCAM_FMT_YUYV:  f->ndim = 3; f->shape[2] = 2; break;
+        case WEBCAM_FMT_YUV420:
+        case WEBCAM_FMT_NV12:  f->shape[0] = h * 3 / 2; break;
+        case WEBCAM_FMT_SRGGB10:
+        case WEBCAM_FMT_SBGGR10:
+        case WEBCAM_FMT_SGRBG10:
+        case WEBCAM_FMT_SGBRG10:
+            f->itemsize = 2;
+            f->format = "<H";
+            f->typestr = "<u2";
+            break;
+        default: break;
+    }
+
+    // MJPEG, odd 4:2:0 sizes or short buffers: flat bytes
+    Py_ssize_t n = f->itemsize;
+    for (int i = 0; i < f->ndim; i++) n *= f->shape[i];
+    if (fr->format == WEBCAM_FMT_MJPEG || n != fr->size) {
+        f->itemsize = 1;
+        f->format = "B";
+        f->typestr = "|u1";
+        f->ndim = 1;
+        f->shape[0] = fr->size;
+    }
+}
+
+static void frame_hand_back(FrameObject *f) {
+    CameraObject *camera = f->camera;
+    if (!camera) return;
+    f->camera = NULL;
+    f->release_pending = 0;
+    webcam_return_frame(camera->cam, &f->frame);
+    camera->leases--;
+    Py_DECREF(camera);
+}
+
+static FrameObject* frame_new(CameraObject *camera, const WebcamFrame *frame) {
+    FrameObject *f = PyObject_New(FrameObject, &FrameType);
+    if (!f) {
+        webcam_return_frame(camera->cam, frame);
+        return NULL;
+    }
+    Py_INCREF(camera);
+    f->camera = camera;
+    f->frame = *frame;
+    f->exports = 0;
+    f->release_pending = 0;
+    frame_layout(f);
+    camera->leases++;
+    return f;
+}
+
+static void Frame_dealloc(FrameObject *f) {
+    frame_hand_back(f);     // Views hold a reference, so none are left here
+    PyObject_Del(f);
+}
+
+static int Frame_getbuffer(FrameObject *f, Py_buffer *view, int flags) {
+    if (!f->camera || f->release_pending) {
+        PyErr_SetString(PyExc_BufferError, "frame already released");
+        return -1;
+    }
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "frames are read-only");
+        return -1;
+    }
+
+    view->obj = (PyObject*)f;
+    view->buf = (void*)f->frame.data;
+    view->len = f->frame.size;
+    view->readonly = 1;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    if ((flags & PyBUF_ND) == PyBUF_ND && (flags & PyBUF_FORMAT) == PyBUF_FORMAT) {
+        view->itemsize = f->itemsize;
+        view->format = (char*)f->format;
+        view->ndim = f->ndim;
+        view->shape = f->shape;
+    } else if ((flags & PyBUF_ND) == PyBUF_ND) {
+        // Without a format the consumer assumes bytes
+        view->itemsize = 1;
+        view->format = NULL;
+        view->ndim = 1;
+        view->shape = &view->len;
+    } else {
+        view->itemsize = 1;
+        view->format = NULL;
+        view->ndim = 1;
+        view->shape = NULL;
+    }
+    view->strides = NULL;   // C-contiguous
+    Py_INCREF(f);
+    f->exports++;
+    return 0;
+}
+
+static void Frame_releasebuffer(FrameObject *f, Py_buffer *view) {
+    (void)view;
+    if (--f->exports == 0 && f->release_pending) frame_hand_back(f);
+}
+
+static PyObject* Frame_release(FrameObject *f, PyObject *unused) {
+    (void)unused;
+    if (f->exports > 0) f->release_pending = 1;   // Last view hands it back
+    else frame_hand_back(f);
+    Py_RETURN_NONE;
+}
+
+static PyObject* Frame_enter(FrameObject *f, PyObject *unused) {
+    (void)unused;
+    Py_INCREF(f);
+    return (PyObject*)f;
+}
+
+static PyObject* Frame_exit(FrameObject *f, PyObject *args) {
+    (void)args;
+    return Frame_release(f, NULL);
+}
+
+static PyObject* Frame_array_interface(FrameObject *f, void *closure) {
+    (void)closure;
+    if (!f->camera || f->release_pending) {
+        PyErr_SetString(PyExc_BufferError, "frame already released");
+        return NULL;
+    }
+    PyObject *shape = PyTuple_New(f->ndim);
+    if (!shape) return NULL;
+    for (int i = 0; i < f->ndim; i++)
+        PyTuple_SET_ITEM(shape, i, PyLong_FromSsize_t(f->shape[i]));
+    // data is the frame itself, so consumers go through the tracked buffer
+    return Py_BuildValue("{s:N,s:s,s:O,s:i}", "shape", shape, "typestr", f->typestr,
+                         "data", (PyObject*)f, "version", 3);
+}
+
+static PyObject* Frame_released(FrameObject *f, void *closure) {
+    (void)closure;
+    return PyBool_FromLong(!f->camera || f->release_pending);
+}
+
+static PyObject* Frame_shape(FrameObject *f, void *closure) {
+    (void)closure;
+    PyObject *shape = PyTuple_New(f->ndim);
+    if (!shape) return NULL;
+    for (int i = 0; i < f->ndim; i++)
+        PyTuple_SET_ITEM(shape, i, PyLong_FromSsize_t(f->shape[i]));
+    return shape;
+}
+
+static PyObject* Frame_width(FrameObject *f, void *c) { (void)c; return PyLong_FromLong(f->frame.width); }
+static PyObject* Frame_height(FrameObject *f, void *c) { (void)c; return PyLong_FromLong(f->frame.height); }
+static PyObject* Frame_size(FrameObject *f, void *c) { (void)c; return PyLong_FromLong(f->frame.size); }
+static PyObject* Frame_format(FrameObject *f, void *c) { (void)c; return PyLong_FromLong(f->frame.format); }
+static PyObject* Frame_timestamp_us(FrameObject *f, void *c) {
+    (void)c;
+    return PyLong_FromUnsignedLongLong(f->frame.timestamp_us);
+}
+static PyObject* Frame_control_generation(FrameObject *f, void *c) {
+    (void)c;
+    return PyLong_FromUnsignedLong(f->frame.control_generation);
+}
+
+static PyMethodDef Frame_methods[] = {
+    {"release", (PyCFunction)Frame_release, METH_NOARGS,
+     "Hand the buffer back to the driver (deferred while views exist)."},
+    {"__enter__", (PyCFunction)Frame_enter, METH_NOARGS, NULL},
+    {"__exit__", (PyCFunction)Frame_exit, METH_VARARGS, NULL},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Frame_getset[] = {
+    {"__array_interface__", (getter)Frame_array_interface, NULL, NULL, NULL},
+    {"released", (getter)Frame_released, NULL, "True once release() was called.", NULL},
+    {"shape", (getter)Frame_shape, NULL, "Shape of the array view.", NULL},
+    {"width", (getter)Frame_width, NULL, NULL, NULL},
+    {"height", (getter)Frame_height, NULL, NULL, NULL},
+    {"size", (getter)Frame_size, NULL, "Bytes in the buffer.", NULL},
+    {"format", (getter)Frame_format, NULL, "FMT_* constant.", NULL},
+    {"timestamp_us", (getter)Frame_timestamp_us, NULL, "Monotonic capture time.", NULL},
+    {"control_generation", (getter)Frame_control_generation, NULL,
+     "Newest control change applied before capture.", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyBufferProcs Frame_as_buffer = {
+    (getbufferproc)Frame_getbuffer,
+    (releasebufferproc)Frame_releasebuffer,
+};
+
+// ============================================================================
+// Camera
+// ============================================================================
+
+static int camera_check(CameraObject *self) {
+    if (self->cam) return 0;
+    PyErr_SetString(PyExc_ValueError, "camera is closed");
+    return -1;
+}
+
+static int Camera_init(CameraObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"width", "height", "device", "format", "fps", NULL};
+    int width, height, device = 0, format = WEBCAM_FMT_YUYV, fps = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ii|iii", kwlist,
+                                     &width, &height, &device, &format, &fps))
+        return -1;
+    if (self->cam) {
+        PyErr_SetString(PyExc_RuntimeError, "camera already open");
+        return -1;
+    }
+
+    Webcam *cam;
+    Py_BEGIN_ALLOW_THREADS
+    cam = webcam_open_fps(width, height, device, (WebcamPixelFormat)format, fps);
+    Py_END_ALLOW_THREADS
+    if (!cam) {
+        PyErr_Format(PyExc_OSError, "cannot open device %d", device);
+        return -1;
+    }
+    self->cam = cam;
+    return 0;
+}
+
+static PyObject* Camera_close(CameraObject *self, PyObject *unused) {
+    (void)unused;
+    if (!self->cam) Py_RETURN_NONE;
+    if (self->leases > 0 || self->calls > 0) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "camera still has frames or calls in flight; release them first");
+        return NULL;
+    }
+    webcam_close(self->cam);
+    self->cam = NULL;
+    Py_RETURN_NONE;
+}
+
+static void Camera_dealloc(CameraObject *self) {
+    // Frames keep their camera alive, so nothing is leased here
+    if (self->cam) webcam_close(self->cam);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static PyObject* camera_capture(CameraObject *self, long timeout_us) {
+    if (camera_check(self) < 0) return NULL;
+    if (self->capturing) {
+        PyErr_SetString(PyExc_RuntimeError, "capture already running on another thread");
+        return NULL;
+    }
+#ifdef _WIN32
+    // The Windows backend holds a single sample at a time
+    if (self->leases > 0) {
+        PyErr_SetString(PyExc_RuntimeError, "release the previous frame first");
+        return NULL;
+    }
+#endif
+
+    WebcamFrame frame;
+    int r;
+    self->capturing = 1;
+    self->calls++;
+    Py_BEGIN_ALLOW_THREADS
+    r = webcam_capture_timeout(self->cam, &frame, timeout_us);
+    Py_END_ALLOW_THREADS
+    self->calls--;
+    self->capturing = 0;
+
+    if (r == -2) Py_RETURN_NONE;
+    if (r != 0) {
+        PyErr_SetString(PyExc_OSError, "capture failed");
+        return NULL;
+    }
+    return (PyObject*)frame_new(self, &frame);
+}
+
+static PyObject* Camera_capture(CameraObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"timeout", NULL};
+    PyObject *timeout = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O", kwlist, &timeout)) return NULL;
+
+    long timeout_us = 2000000;  // Same as webcam_capture()
+    if (timeout != Py_None) {
+        double seconds = PyFloat_AsDouble(timeout);
+        if (seconds == -1.0 && PyErr_Occurred()) return NULL;
+        timeout_us = seconds < 0 ? -1 : seconds > 2000.0 ? 2000000000L : (long)(seconds * 1e6);
+    }
+    return camera_capture(self, timeout_us);
+}
+
+static PyObject* Camera_try_capture(CameraObject *self, PyObject *unused) {
+    (void)unused;
+    return camera_capture(self, 0);
+}
+
+static PyObject* Camera_get(CameraObject *self, PyObject *args) {
+    int param;
+    if (!PyArg_ParseTuple(args, "i", &param) || camera_check(self) < 0) return NULL;
+    long value;
+    self->calls++;
+    Py_BEGIN_ALLOW_THREADS
+    value = webcam_get_parameter(self->cam, (WebcamParameter)param);
+    Py_END_ALLOW_THREADS
+    self->calls--;
+    return PyLong_FromLong(value);
+}
+
+static PyObject* control_result(int r) {
+    if (r == -2) {
+        PyErr_SetString(PyExc_BufferError, "control queue is full");
+        return NULL;
+    }
+    if (r != 0) {
+        PyErr_SetString(PyExc_OSError, "control rejected");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* Camera_set(CameraObject *self, PyObject *args) {
+    int param;
+    long value;
+    if (!PyArg_ParseTuple(args, "il", &param, &value) || camera_check(self) < 0) return NULL;
+    int r;
+    self->calls++;
+    Py_BEGIN_ALLOW_THREADS
+    r = webcam_set_parameter(self->cam, (WebcamParameter)param, value);
+    Py_END_ALLOW_THREADS
+    self->calls--;
+    return control_result(r);
+}
+
+static PyObject* Camera_set_auto(CameraObject *self, PyObject *args) {
+    int param, is_auto;
+    if (!PyArg_ParseTuple(args, "ip", &param, &is_auto) || camera_check(self) < 0) return NULL;
+    int r;
+    self->calls++;
+    Py_BEGIN_ALLOW_THREADS
+    r = webcam_set_auto(self->cam, (WebcamParameter)param, is_auto);
+    Py_END_ALLOW_THREADS
+    self->calls--;
+    return control_result(r);
+}
+
+// Never touches the driver, so the GIL is kept
+static PyObject* Camera_queue(CameraObject *self, PyObject *args) {
+    int param;
+    long value;
+    if (!PyArg_ParseTuple(args, "il", &param, &value) || camera_check(self) < 0) return NULL;
+    uint32_t gen = 0;
+    int r = webcam_queue_parameter(self->cam, (WebcamParameter)param, value, &gen);
+    if (r != 0) return control_result(r);
+    return PyLong_FromUnsignedLong(gen);
+}
+
+static PyObject* Camera_set_fps(CameraObject *self, PyObject *args) {
+    int fps;
+    if (!PyArg_ParseTuple(args, "i", &fps) || camera_check(self) < 0) return NULL;
+    if (self->calls > 0 || self->leases > 0) {
+        PyErr_SetString(PyExc_RuntimeError, "set_fps needs an idle camera with no frames held");
+        return NULL;
+    }
+    if (webcam_set_fps(self->cam, fps) != 0) {
+        PyErr_SetString(PyExc_OSError, "frame rate rejected");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject* Camera_set_decimation(CameraObject *self, PyObject *args) {
+    int every_nth, max_fps = 0;
+    if (!PyArg_ParseTuple(args, "i|i", &every_nth, &max_fps) || camera_check(self) < 0) return NULL;
+    webcam_set_decimation(self->cam, every_nth, max_fps);
+    Py_RETURN_NONE;
+}
+
+static PyObject* Camera_enter(CameraObject *self, PyObject *unused) {
+    (void)unused;
+    if (camera_check(self) < 0) return NULL;
+    Py_INCREF(self);
+    return (PyObject*)self;
+}
+
+static PyObject* Camera_exit(CameraObject *self, PyObject *args) {
+    (void)args;
+    return Camera_close(self, NULL);
+}
+
+static PyObject* Camera_width(CameraObject *self, void *c) {
+    (void)c;
+    return PyLong_FromLong(webcam_get_actual_width(self->cam));
+}
+static PyObject* Camera_height(CameraObject *self, void *c) {
+    (void)c;
+    return PyLong_FromLong(webcam_get_actual_height(self->cam));
+}
+static PyObject* Camera_format(CameraObject *self, void *c) {
+    (void)c;
+    return PyLong_FromLong(webcam_get_format(self->cam));
+}
+static PyObject* Camera_fd(CameraObject *self, void *c) {
+    (void)c;
+    return PyLong_FromLong(webcam_get_fd(self->cam));
+}
+static PyObject* Camera_fps(CameraObject *self, void *c) {
+    (void)c;
+    return PyLong_FromLong(webcam_get_fps(self->cam));
+}
+static PyObject* Camera_control_generation(CameraObject *self, void *c) {
+    (void)c;
+    return PyLong_FromUnsignedLong(webcam_get_control_generation(self->cam));
+}
+static PyObject* Camera_closed(CameraObject *self, void *c) {
+    (void)c;
+    return PyBool_FromLong(self->cam == NULL);
+}
+
+static PyMethodDef Camera_methods[] = {
+    {"capture", (PyCFunction)(void(*)(void))Camera_capture, METH_VARARGS | METH_KEYWORDS,
+     "capture(timeout=None) -> Frame or None on timeout. Releases the GIL while waiting;\n"
+     "timeout in seconds, None = 2 s, negative = forever."},
+    {"try_capture", (PyCFunction)Camera_try_capture, METH_NOARGS,
+     "Frame if one is ready, else None. Never waits."},
+    {"close", (PyCFunction)Camera_close, METH_NOARGS, NULL},
+    {"get", (PyCFunction)Camera_get, METH_VARARGS, "get(PARAM_*) -> value, -1 if unsupported."},
+    {"set", (PyCFunction)Camera_set, METH_VARARGS, "set(PARAM_*, value). Thread-safe."},
+    {"set_auto", (PyCFunction)Camera_set_auto, METH_VARARGS, "set_auto(PARAM_*, bool)."},
+    {"queue", (PyCFunction)Camera_queue, METH_VARARGS,
+     "queue(PARAM_*, value) -> generation. Applied by the next capture; never blocks."},
+    {"set_fps", (PyCFunction)Camera_set_fps, METH_VARARGS, NULL},
+    {"set_decimation", (PyCFunction)Camera_set_decimation, METH_VARARGS,
+     "set_decimation(every_nth, max_fps=0)."},
+    {"__enter__", (PyCFunction)Camera_enter, METH_NOARGS, NULL},
+    {"__exit__", (PyCFunction)Camera_exit, METH_VARARGS, NULL},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Camera_getset[] = {
+    {"width", (getter)Camera_width, NULL, NULL, NULL},
+    {"height", (getter)Camera_height, NULL, NULL, NULL},
+    {"format", (getter)Camera_format, NULL, NULL, NULL},
+    {"fd", (getter)Camera_fd, NULL, "Pollable fd, -1 if none.", NULL},
+    {"fps", (getter)Camera_fps, NULL, NULL, NULL},
+    {"control_generation", (getter)Camera_control_generation, NULL, NULL, NULL},
+    {"closed", (getter)Camera_closed, NULL, NULL, NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+// ============================================================================
+// Module
+// ============================================================================
+
+static PyObject* list_devices(PyObject *module, PyObject *unused) {
+    (void)module;
+    (void)unused;
+    int count = 0;
+    WebcamInfo *list;
+    Py_BEGIN_ALLOW_THREADS
+    list = webcam_list_devices(&count);
+    Py_END_ALLOW_THREADS
+
+    PyObject *out = PyList_New(0);
+    for (int i = 0; out && list && i < count; i++) {
+        PyObject *item = Py_BuildValue("(iss)", list[i].index, list[i].name, list[i].path);
+        if (!item || PyList_Append(out, item) < 0) Py_CLEAR(out);
+        Py_XDECREF(item);
+    }
+    webcam_free_list(list);
+    return out;
+}
+
+static PyMethodDef module_methods[] = {
+    {"list_devices", list_devices, METH_NOARGS, "[(index, name, path), ...]"},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef webcam_module = {
+    PyModuleDef_HEAD_INIT, "webcam",
+    "Zero-copy webcam capture. Frames are read-only views over the driver buffer.",
+    -1, module_methods, NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_webcam(void) {
+    FrameType.tp_name = "webcam.Frame";
+    FrameType.tp_basicsize = sizeof(FrameObject);
+    FrameType.tp_flags = Py_TPFLAGS_DEFAULT;
+    FrameType.tp_doc = "Lease on a captured buffer; use as a context manager.";
+    FrameType.tp_dealloc = (destructor)Frame_dealloc;
+    FrameType.tp_as_buffer = &Frame_as_buffer;
+    FrameType.tp_methods = Frame_methods;
+    FrameType.tp_getset = Frame_getset;
+
+    CameraType.tp_name = "webcam.Camera";
+    CameraType.tp_basicsize = sizeof(CameraObject);
+    CameraType.tp_flags = Py_TPFLAGS_DEFAULT;
+    CameraType.tp_doc = "Camera(width, height, device=0, format=FMT_YUYV, fps=0)";
+    CameraType.tp_new = PyType_GenericNew;
+    CameraType.tp_init = (initproc)Camera_init;
+    CameraType.tp_dealloc = (destructor)Camera_dealloc;
+    CameraType.tp_methods = Camera_methods;
+    CameraType.tp_getset = Camera_getset;
+
+    if (PyType_Ready(&FrameType) < 0 || PyType_Ready(&CameraType) < 0) return NULL;
+
+    PyObject *m = PyModule_Create(&webcam_module);
+    if (!m) return NULL;
+    Py_INCREF(&CameraType);
+    Py_INCREF(&FrameType);
+    if (PyModule_AddObject(m, "Camera", (PyObject*)&CameraType) < 0 ||
+        PyModule_AddObject(m, "Frame", (PyObject*)&FrameType) < 0) {
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    static const struct { const char *name; long value; } constants[] = {
+        {"FMT_RGB24", WEBCAM_FMT_RGB24}, {"FMT_RGB32", WEBCAM_FMT_RGB32},
+        {"FMT_YUYV", WEBCAM_FMT_YUYV}, {"FMT_YUV420", WEBCAM_FMT_YUV420},
+        {"FMT_MJPEG", WEBCAM_FMT_MJPEG}, {"FMT_NV12", WEBCAM_FMT_NV12},
+        {"FMT_GRAY8", WEBCAM_FMT_GRAY8},
+        {"FMT_SRGGB8", WEBCAM_FMT_SRGGB8}, {"FMT_SBGGR8", WEBCAM_FMT_SBGGR8},
+        {"FMT_SGRBG8", WEBCAM_FMT_SGRBG8}, {"FMT_SGBRG8", WEBCAM_FMT_SGBRG8},
+        {"FMT_SRGGB10", WEBCAM_FMT_SRGGB10}, {"FMT_SBGGR10", WEBCAM_FMT_SBGGR10},
+        {"FMT_SGRBG10", WEBCAM_FMT_SGRBG10}, {"FMT_SGBRG10", WEBCAM_FMT_SGBRG10},
+        {"PARAM_BRIGHTNESS", WEBCAM_PARAM_BRIGHTNESS}, {"PARAM_CONTRAST", WEBCAM_PARAM_CONTRAST},
+        {"PARAM_SATURATION", WEBCAM_PARAM_SATURATION}, {"PARAM_EXPOSURE", WEBCAM_PARAM_EXPOSURE},
+        {"PARAM_FOCUS", WEBCAM_PARAM_FOCUS}, {"PARAM_ZOOM", WEBCAM_PARAM_ZOOM},
+        {"PARAM_GAIN", WEBCAM_PARAM_GAIN}, {"PARAM_SHARPNESS", WEBCAM_PARAM_SHARPNESS},
+        {"PARAM_HFLIP", WEBCAM_PARAM_HFLIP}, {"PARAM_VFLIP", WEBCAM_PARAM_VFLIP},
+    };
+    for (size_t i = 0; i < sizeof(constants) / sizeof(constants[0]); i++) {
+        if (PyModule_AddIntConstant(m, constants[i].name, constants[i].value) < 0) {
+            Py_DECREF(m);
+            return NULL;
+        }
+    }
+    return m;
+}
@@ -0,0 +1,66 @@
+// ============================================================================
+// webcam_atomic.h - Minimal atomics shared by the portable modules
+// ============================================================================
+#ifndef WEBCAM_ATOMIC_H
+#define WEBCAM_ATOMIC_H
+
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+  static __inline long atomic_add_32(volatile long *p, long v) {
+      return _InterlockedExchangeAdd(p, v) + v;
+  }
+  static __inline int64_t atomic_add_64(volatile int64_t *p, int64_t v) {
+      return _InterlockedExchangeAdd64((volatile __int64*)p, v) + v;
+  }
+  static __inline int64_t atomic_load_64(volatile int64_t *p) {
+      return _InterlockedCompareExchange64((volatile __int64*)p, 0, 0);
+  }
+  static __inline int atomic_cas_64(volatile int64_t *p, int64_t *expected, int64_t desired) {
+      int64_t prev = _InterlockedCompareExchange64((volatile __int64*)p, desired, *expected);
+      if (prev == *expected) return 1;
+      *expected = prev;
+      return 0;
+  }
+  static __inline void atomic_store_64(volatile int64_t *p, int64_t v) {
+      _InterlockedExchange64((volatile __int64*)p, v);
+  }
+  static __inline int atomic_cas_32(volatile long *p, long *expected, long desired) {
+      long prev = _InterlockedCompareExchange(p, desired, *expected);
+      if (prev == *expected) return 1;
+      *expected = prev;
+      return 0;
+  }
+  static __inline long atomic_exchange_32(volatile long *p, long v) {
+      return _InterlockedExchange(p, v);
+  }
+  #define atomic_load_32(p)             _InterlockedCompareExchange((volatile long*)(p), 0, 0)
+  #define atomic_store_32(p, v)          ((void)_InterlockedExchange((volatile long*)(p), (v)))
+  #define atomic_relaxed_load_32(p)     (*(volatile long*)(p))
+  #define atomic_relaxed_store_32(p, v)  (*(volatile long*)(p) = (v))
+  #if defined(_M_ARM) || defined(_M_ARM64)
+    #define atomic_fence()              __dmb(0xB)  // ISH
+  #else
+    #define atomic_fence()              _ReadWriteBarrier()  // x86 keeps load/store order
+  #endif
+  typedef long atomic_int32;
+#else
+  #define atomic_add_32(p, v)  __atomic_add_fetch((p), (v), __ATOMIC_ACQ_REL)
+  #define atomic_add_64(p, v)  __atomic_add_fetch((p), (v), __ATOMIC_ACQ_REL)
+  #define atomic_load_64(p)    __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define atomic_cas_64(p, e, d) \
+      __atomic_compare_exchange_n((p), (e), (d), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+  #define atomic_store_64(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+  #define atomic_cas_32(p, e, d) \
+      __atomic_compare_exchange_n((p), (e), (d), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+  #define atomic_exchange_32(p, v)      __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+  #define atomic_load_32(p)             __atomic_load_n((p), __ATOMIC_ACQUIRE)
+  #define atomic_store_32(p, v)          __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+  #define atomic_relaxed_load_32(p)     __atomic_load_n((p), __ATOMIC_RELAXED)
+  #define atomic_relaxed_store_32(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+  #define atomic_fence()                __atomic_thread_fence(__ATOMIC_SEQ_CST)
+  typedef int atomic_int32;
+#endif
+
+#endif // WEBCAM_ATOMIC_H
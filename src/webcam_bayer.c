@@ -0,0 +1,486 @@
+// ============================================================================
+// webcam_bayer.c - Raw Bayer demosaic (bilinear, edge-directed, 2x2 binning)
+// ============================================================================
+// Source rows are split into their even and odd columns ("halves") as int16,
+// with mirrored borders, so every neighbour of a Bayer site is a plain offset
+// into one of the two halves and the kernels run eight sites at a time (SSE2
+// on x86). The edge-directed mode interpolates green along the weaker of the
+// horizontal / vertical gradients (Hamilton-Adams), then red and blue as
+// bilinear color differences against that green. 10-bit data keeps its full
+// precision until the final pack to 8 bits.
+// ============================================================================
+#include "webcam_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define BAYER_SSE2 1
+#endif
+
+#define LANES 8
+#define PAD 8               // Mirrored halves on each side of a line
+
+typedef struct {
+    int rx, ry;             // Position of red in the 2x2 cell
+    int shift;              // Bits above 8 (0 or 2)
+} BayerPattern;
+
+static int bayer_pattern(WebcamPixelFormat format, BayerPattern *p) {
+    p->shift = 0;
+    switch (format) {
+        case WEBCAM_FMT_SRGGB10: p->shift = 2; /* fall through */
+        case WEBCAM_FMT_SRGGB8:  p->rx = 0; p->ry = 0; return 1;
+        case WEBCAM_FMT_SBGGR10: p->shift = 2; /* fall through */
+        case WEBCAM_FMT_SBGGR8:  p->rx = 1; p->ry = 1; return 1;
+        case WEBCAM_FMT_SGRBG10: p->shift = 2; /* fall through */
+        case WEBCAM_FMT_SGRBG8:  p->rx = 1; p->ry = 0; return 1;
+        case WEBCAM_FMT_SGBRG10: p->shift = 2; /* fall through */
+        case WEBCAM_FMT_SGBRG8:  p->rx = 0; p->ry = 1; return 1;
+        default: return 0;
+    }
+}
+
+int webcam_is_bayer(WebcamPixelFormat format) {
+    BayerPattern p;
+    return bayer_pattern(format, &p);
+}
+
+// Mirror without repeating the edge, which keeps the Bayer parity
+static int reflect(int v, int n) {
+    if (v < 0) v = -v;
+    if (v >= n) v = 2 * n - 2 - v;
+    return v < 0 ? 0 : (v >= n ? n - 1 : v);
+}
+
+static int raw_at(const WebcamFrame *src, int shift, int x, int y) {
+    size_t i = (size_t)reflect(y, src->height) * src->width + reflect(x, src->width);
+    if (!shift) return src->data[i];
+    return (src->data[i * 2] | (src->data[i * 2 + 1] << 8)) & 0x3FF;
+}
+
+static unsigned char pack(int v, int shift) {
+    int max = 255 << shift;
+    return (unsigned char)((v < 0 ? 0 : (v > max ? max : v)) >> shift);
+}
+
+// ---------------------------------------------------------------------------
+// Scalar bilinear row, used by webcam_convert()/crop()/scale()
+// ---------------------------------------------------------------------------
+
+void webcam_bayer_row(const WebcamFrame *src, int y, int x0, int w, unsigned char *out, int bpp) {
+    BayerPattern p;
+    if (!bayer_pattern(src->format, &p)) return;
+    const int s = p.shift;
+
+    for (int x = x0; x < x0 + w; x++, out += bpp) {
+        int c = raw_at(src, s, x, y);
+        int h = (raw_at(src, s, x - 1, y) + raw_at(src, s, x + 1, y) + 1) >> 1;
+        int v = (raw_at(src, s, x, y - 1) + raw_at(src, s, x, y + 1) + 1) >> 1;
+        int red_row = (y & 1) == p.ry, red_col = (x & 1) == p.rx;
+        int r, g, b;
+        if (red_row == red_col) {
+            // Red or blue site
+            int cross = (raw_at(src, s, x - 1, y) + raw_at(src, s, x + 1, y) +
+                         raw_at(src, s, x, y - 1) + raw_at(src, s, x, y + 1) + 2) >> 2;
+            int diag = (raw_at(src, s, x - 1, y - 1) + raw_at(src, s, x + 1, y - 1) +
+                        raw_at(src, s, x - 1, y + 1) + raw_at(src, s, x + 1, y + 1) + 2) >> 2;
+            g = cross;
+            r = red_row ? c : diag;
+            b = red_row ? diag : c;
+        } else {
+            g = c;
+            r = red_row ? h : v;
+            b = red_row ? v : h;
+        }
+        out[0] = pack(r, s);
+        out[1] = pack(g, s);
+        out[2] = pack(b, s);
+        if (bpp == 4) out[3] = 255;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Eight int16 lanes
+// ---------------------------------------------------------------------------
+
+#ifdef BAYER_SSE2
+typedef __m128i vs;
+#define vs_load(p)      _mm_loadu_si128((const __m128i*)(p))
+#define vs_store(p, v)  _mm_storeu_si128((__m128i*)(p), (v))
+#define vs_add(a, b)    _mm_add_epi16((a), (b))
+#define vs_sub(a, b)    _mm_sub_epi16((a), (b))
+#define vs_sra(a, n)    _mm_srai_epi16((a), (n))
+#define vs_k(k)         _mm_set1_epi16(k)
+static vs vs_abs(vs a) { return _mm_max_epi16(a, _mm_sub_epi16(_mm_setzero_si128(), a)); }
+static vs vs_clamp(vs a, int max) {
+    return _mm_min_epi16(_mm_max_epi16(a, _mm_setzero_si128()), _mm_set1_epi16((short)max));
+}
+// a < b ? x : (b < a ? y : z)
+static vs vs_pick(vs a, vs b, vs x, vs y, vs z) {
+    vs lt = _mm_cmplt_epi16(a, b), gt = _mm_cmpgt_epi16(a, b);
+    vs r = _mm_or_si128(_mm_and_si128(lt, x), _mm_andnot_si128(lt, z));
+    return _mm_or_si128(_mm_and_si128(gt, y), _mm_andnot_si128(gt, r));
+}
+#else
+typedef struct { int v[LANES]; } vs;
+static vs vs_load(const short *p) { vs r; for (int i = 0; i < LANES; i++) r.v[i] = p[i]; return r; }
+static void vs_store(short *p, vs a) { for (int i = 0; i < LANES; i++) p[i] = (short)a.v[i]; }
+static vs vs_add(vs a, vs b) { for (int i = 0; i < LANES; i++) a.v[i] += b.v[i]; return a; }
+static vs vs_sub(vs a, vs b) { for (int i = 0; i < LANES; i++) a.v[i] -= b.v[i]; return a; }
+static vs vs_sra(vs a, int n) { for (int i = 0; i < LANES; i++) a.v[i] >>= n; return a; }
+static vs vs_k(int k) { vs r; for (int i = 0; i < LANES; i++) r.v[i] = k; return r; }
+static vs vs_abs(vs a) { for (int i = 0; i < LANES; i++) a.v[i] = a.v[i] < 0 ? -a.v[i] : a.v[i]; return a; }
+static vs vs_clamp(vs a, int max) {
+    for (int i = 0; i < LANES; i++) a.v[i] = a.v[i] < 0 ? 0 : (a.v[i] > max ? max : a.v[i]);
+    return a;
+}
+static vs vs_pick(vs a, vs b, vs x, vs y, vs z) {
+    for (int i = 0; i < LANES; i++)
+        x.v[i] = a.v[i] < b.v[i] ? x.v[i] : (b.v[i] < a.v[i] ? y.v[i] : z.v[i]);
+    return x;
+}
+#endif
+
+// (a + b + 1) >> 1 and (a + b + c + d + 2) >> 2
+static vs vs_avg2(vs a, vs b) { return vs_sra(vs_add(vs_add(a, b), vs_k(1)), 1); }
+static vs vs_avg4(vs a, vs b, vs c, vs d) {
+    return vs_sra(vs_add(vs_add(vs_add(a, b), vs_add(c, d)), vs_k(2)), 2);
+}
+
+// ---------------------------------------------------------------------------
+// Line cache: source rows split into even / odd halves
+// ---------------------------------------------------------------------------
+
+#define RAW_SLOTS 8         // Rows y - 3 .. y + 3
+#define GREEN_SLOTS 4       // Rows y - 1 .. y + 1
+
+typedef struct {
+    short *h[2];            // Even / odd columns, PAD mirrored halves each side
+    int row;                // Unreflected row held, or INT_MIN
+} Line;
+
+typedef struct {
+    const WebcamFrame *src;
+    BayerPattern pat;
+    int half;               // Halves per row (width / 2)
+    int stride;             // Allocated shorts per half
+    Line raw[RAW_SLOTS];
+    Line green[GREEN_SLOTS];
+    short *out[2][3];       // Per phase, R / G / B
+    short *mem;
+} Demosaic;
+
+// Neighbours of the sites of phase ph (0 = even columns): the same column,
+// and the columns to the left / right, which sit in the other half
+static const short* same(const Line *l, int ph) { return l->h[ph]; }
+static const short* left(const Line *l, int ph) { return ph ? l->h[0] : l->h[1] - 1; }
+static const short* right(const Line *l, int ph) { return ph ? l->h[0] + 1 : l->h[1]; }
+
+static int demosaic_init(Demosaic *d, const WebcamFrame *src) {
+    memset(d, 0, sizeof(*d));
+    d->src = src;
+    if (!bayer_pattern(src->format, &d->pat)) return -1;
+    d->half = src->width / 2;
+    d->stride = (d->half + LANES - 1) / LANES * LANES + 2 * PAD;
+
+    int lines = (RAW_SLOTS + GREEN_SLOTS) * 2 + 6;
+    d->mem = (short*)malloc((size_t)lines * d->stride * sizeof(short));
+    if (!d->mem) return -1;
+    short *p = d->mem;
+    for (int i = 0; i < RAW_SLOTS; i++, p += 2 * d->stride) {
+        d->raw[i].h[0] = p + PAD;
+        d->raw[i].h[1] = p + d->stride + PAD;
+        d->raw[i].row = -0x7FFFFFFF;
+    }
+    for (int i = 0; i < GREEN_SLOTS; i++, p += 2 * d->stride) {
+        d->green[i].h[0] = p + PAD;
+        d->green[i].h[1] = p + d->stride + PAD;
+        d->green[i].row = -0x7FFFFFFF;
+    }
+    for (int ph = 0; ph < 2; ph++)
+        for (int c = 0; c < 3; c++, p += d->stride) d->out[ph][c] = p + PAD;
+    return 0;
+}
+
+static const Line* raw_line(Demosaic *d, int row) {
+    Line *l = &d->raw[row & (RAW_SLOTS - 1)];
+    if (l->row == row) return l;
+    l->row = row;
+
+    const WebcamFrame *src = d->src;
+    const int n = d->half, W = src->width;
+    const int y = reflect(row, src->height);
+    short *e = l->h[0], *o = l->h[1];
+    int i = 0;
+    if (!d->pat.shift) {
+        const unsigned char *s = src->data + (size_t)y * W;
+#ifdef BAYER_SSE2
+        const __m128i lo = _mm_set1_epi16(0xFF);
+        for (; i + LANES <= n; i += LANES) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(s + 2 * i));
+            _mm_storeu_si128((__m128i*)(e + i), _mm_and_si128(v, lo));
+            _mm_storeu_si128((__m128i*)(o + i), _mm_srli_epi16(v, 8));
+        }
+#endif
+        for (; i < n; i++) {
+            e[i] = s[2 * i];
+            o[i] = s[2 * i + 1];
+        }
+    } else {
+        const unsigned char *s = src->data + (size_t)y * W * 2;
+        for (; i < n; i++) {
+            e[i] = (short)((s[4 * i] | (s[4 * i + 1] << 8)) & 0x3FF);
+            o[i] = (short)((s[4 * i + 2] | (s[4 * i + 3] << 8)) & 0x3FF);
+        }
+    }
+
+    // Mirrored borders; pixel -k is pixel k, pixel W - 1 + k is W - 1 - k
+    for (int k = 1; k <= PAD; k++) {
+        e[-k] = e[reflect(-2 * k, W) >> 1];
+        o[-k] = o[reflect(1 - 2 * k, W) >> 1];
+        e[n - 1 + k] = e[reflect(W - 2 + 2 * k, W) >> 1];
+        o[n - 1 + k] = o[reflect(W - 1 + 2 * k, W) >> 1];
+    }
+    // Tail of the last vector, never output but read by neighbours
+    for (int k = n + PAD; k < d->stride - PAD; k++) e[k] = o[k] = 0;
+    return l;
+}
+
+// Red / blue sites sit at column parity rx on red rows, 1 - rx on blue rows
+static int color_phase(const Demosaic *d, int row) {
+    int red_row = (row & 1) == d->pat.ry;
+    return red_row ? d->pat.rx : 1 - d->pat.rx;
+}
+
+// Full green for one row, Hamilton-Adams at the red / blue sites
+static const Line* green_line(Demosaic *d, int row) {
+    Line *g = &d->green[row & (GREEN_SLOTS - 1)];
+    if (g->row == row) return g;
+    g->row = row;
+
+    const Line *uu = raw_line(d, row - 2), *u = raw_line(d, row - 1), *c = raw_line(d, row);
+    const Line *dn = raw_line(d, row + 1), *dd = raw_line(d, row + 2);
+    const int p = color_phase(d, row), q = 1 - p, n = d->half;
+    const int max = 255 << d->pat.shift;
+
+    memcpy(g->h[q] - PAD, c->h[q] - PAD, (size_t)d->stride * sizeof(short));
+    const short *cs = same(c, p), *cl = left(c, p), *cr = right(c, p);
+    const short *us = same(u, p), *ds = same(dn, p), *uus = same(uu, p), *dds = same(dd, p);
+    short *out = g->h[p];
+    for (int i = 0; i < n; i += LANES) {
+        vs C = vs_load(cs + i), C2 = vs_add(C, C);
+        vs gl = vs_load(cl + i), gr = vs_load(cr + i);
+        vs gu = vs_load(us + i), gd = vs_load(ds + i);
+        vs lap_h = vs_sub(vs_sub(C2, vs_load(cs + i - 1)), vs_load(cs + i + 1));
+        vs lap_v = vs_sub(vs_sub(C2, vs_load(uus + i)), vs_load(dds + i));
+        vs dh = vs_add(vs_abs(vs_sub(gl, gr)), vs_abs(lap_h));
+        vs dv = vs_add(vs_abs(vs_sub(gu, gd)), vs_abs(lap_v));
+        // Four times the directional estimates
+        vs eh = vs_add(vs_add(vs_add(gl, gr), vs_add(gl, gr)), lap_h);
+        vs ev = vs_add(vs_add(vs_add(gu, gd), vs_add(gu, gd)), lap_v);
+        vs e4 = vs_pick(dh, dv, eh, ev, vs_sra(vs_add(eh, ev), 1));
+        vs_store(out + i, vs_clamp(vs_sra(vs_add(e4, vs_k(2)), 2), max));
+    }
+    // Borders of the interpolated half
+    for (int k = 1; k <= PAD; k++) {
+        int W = d->src->width;
+        out[-k] = out[reflect(2 * -k + p, W) >> 1];
+        out[n - 1 + k] = out[reflect(2 * (n - 1 + k) + p, W) >> 1];
+    }
+    return g;
+}
+
+// ---------------------------------------------------------------------------
+// Row kernels: planar R / G / B per phase
+// ---------------------------------------------------------------------------
+
+static void bilinear_row(Demosaic *d, int y) {
+    const Line *u = raw_line(d, y - 1), *c = raw_line(d, y), *dn = raw_line(d, y + 1);
+    const int p = color_phase(d, y), q = 1 - p, n = d->half;
+    const int red_row = (y & 1) == d->pat.ry;
+    // Color (R or B) at the phase-p sites, the other one on the diagonals
+    short *oc = d->out[p][red_row ? 0 : 2], *od = d->out[p][red_row ? 2 : 0];
+    short *og = d->out[p][1];
+    // At the green sites: horizontal neighbours have this row's color
+    short *qh = d->out[q][red_row ? 0 : 2], *qv = d->out[q][red_row ? 2 : 0];
+    short *qg = d->out[q][1];
+
+    const short *cs = same(c, p), *cl = left(c, p), *cr = right(c, p);
+    const short *us = same(u, p), *ul = left(u, p), *ur = right(u, p);
+    const short *ds = same(dn, p), *dl = left(dn, p), *dr = right(dn, p);
+    const short *gs = same(c, q), *gl = left(c, q), *gr = right(c, q);
+    const short *gus = same(u, q), *gds = same(dn, q);
+    for (int i = 0; i < n; i += LANES) {
+        vs_store(oc + i, vs_load(cs + i));
+        vs_store(og + i, vs_avg4(vs_load(cl + i), vs_load(cr + i), vs_load(us + i), vs_load(ds + i)));
+        vs_store(od + i, vs_avg4(vs_load(ul + i), vs_load(ur + i), vs_load(dl + i), vs_load(dr + i)));
+        vs_store(qg + i, vs_load(gs + i));
+        vs_store(qh + i, vs_avg2(vs_load(gl + i), vs_load(gr + i)));
+        vs_store(qv + i, vs_avg2(vs_load(gus + i), vs_load(gds + i)));
+    }
+}
+
+static void edge_row(Demosaic *d, int y) {
+    const Line *u = raw_line(d, y - 1), *c = raw_line(d, y), *dn = raw_line(d, y + 1);
+    const Line *gu = green_line(d, y - 1), *gc = green_line(d, y), *gd = green_line(d, y + 1);
+    // green_line() may have reloaded raw rows; they are cached by row, so the
+    // pointers above stay valid (the window is y - 3 .. y + 3)
+    const int p = color_phase(d, y), q = 1 - p, n = d->half;
+    const int red_row = (y & 1) == d->pat.ry;
+    short *oc = d->out[p][red_row ? 0 : 2], *od = d->out[p][red_row ? 2 : 0];
+    short *og = d->out[p][1];
+    short *qh = d->out[q][red_row ? 0 : 2], *qv = d->out[q][red_row ? 2 : 0];
+    short *qg = d->out[q][1];
+
+    for (int i = 0; i < n; i += LANES) {
+        // Red / blue site: diagonal color from the average color difference
+        vs G = vs_load(same(gc, p) + i);
+        vs diff = vs_avg4(vs_sub(vs_load(left(u, p) + i), vs_load(left(gu, p) + i)),
+                          vs_sub(vs_load(right(u, p) + i), vs_load(right(gu, p) + i)),
+                          vs_sub(vs_load(left(dn, p) + i), vs_load(left(gd, p) + i)),
+                          vs_sub(vs_load(right(dn, p) + i), vs_load(right(gd, p) + i)));
+        vs_store(oc + i, vs_load(same(c, p) + i));
+        vs_store(og + i, G);
+        vs_store(od + i, vs_add(G, diff));
+
+        // Green site: horizontal and vertical color differences
+        vs Gq = vs_load(same(c, q) + i);
+        vs dh = vs_avg2(vs_sub(vs_load(left(c, q) + i), vs_load(left(gc, q) + i)),
+                        vs_sub(vs_load(right(c, q) + i), vs_load(right(gc, q) + i)));
+        vs dv = vs_avg2(vs_sub(vs_load(same(u, q) + i), vs_load(same(gu, q) + i)),
+                        vs_sub(vs_load(same(dn, q) + i), vs_load(same(gd, q) + i)));
+        vs_store(qg + i, Gq);
+        vs_store(qh + i, vs_add(Gq, dh));
+        vs_store(qv + i, vs_add(Gq, dv));
+    }
+}
+
+static void pack_row(const Demosaic *d, unsigned char *out, int bpp) {
+    const int s = d->pat.shift, n = d->half, max = 255 << s;
+    for (int ph = 0; ph < 2; ph++)
+        for (int c = 0; c < 3; c++) {
+            short *v = d->out[ph][c];
+            for (int i = 0; i < n; i += LANES) vs_store(v + i, vs_sra(vs_clamp(vs_load(v + i), max), s));
+        }
+    const short *re = d->out[0][0], *ge = d->out[0][1], *be = d->out[0][2];
+    const short *ro = d->out[1][0], *go = d->out[1][1], *bo = d->out[1][2];
+    for (int i = 0; i < n; i++, out += 2 * bpp) {
+        out[0] = (unsigned char)re[i];
+        out[1] = (unsigned char)ge[i];
+        out[2] = (unsigned char)be[i];
+        out[bpp] = (unsigned char)ro[i];
+        out[bpp + 1] = (unsigned char)go[i];
+        out[bpp + 2] = (unsigned char)bo[i];
+        if (bpp == 4) out[3] = out[7] = 255;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Jobs
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const WebcamFrame *src;
+    WebcamDemosaicMode mode;
+    unsigned char *dst;
+    int bpp;
+    int failed;
+} DemosaicJob;
+
+static void demosaic_rows(void *ctx, int begin, int end) {
+    DemosaicJob *job = (DemosaicJob*)ctx;
+    Demosaic d;
+    if (demosaic_init(&d, job->src) < 0) {
+        job->failed = 1;
+        return;
+    }
+    const size_t stride = (size_t)job->src->width * job->bpp;
+    for (int y = begin; y < end; y++) {
+        if (job->mode == WEBCAM_DEMOSAIC_EDGE) edge_row(&d, y);
+        else bilinear_row(&d, y);
+        pack_row(&d, job->dst + y * stride, job->bpp);
+    }
+    free(d.mem);
+}
+
+// 2x2 binning: one RGB pixel per Bayer cell, green averaged
+static void half_rows(void *ctx, int begin, int end) {
+    DemosaicJob *job = (DemosaicJob*)ctx;
+    const WebcamFrame *src = job->src;
+    BayerPattern p;
+    if (!bayer_pattern(src->format, &p)) {
+        job->failed = 1;
+        return;
+    }
+    const int s = p.shift, bpp = job->bpp, w = src->width / 2;
+    // Cell offsets (row, column) of red, blue and the two greens
+    const int r_off = p.ry * 2 + p.rx, b_off = 3 - r_off;
+    const int g1 = p.ry * 2 + (1 - p.rx), g2 = 3 - g1;
+
+    for (int j = begin; j < end; j++) {
+        unsigned char *out = job->dst + (size_t)j * w * bpp;
+        if (!s) {
+            const unsigned char *row[2] = { src->data + (size_t)(2 * j) * src->width,
+                                            src->data + (size_t)(2 * j + 1) * src->width };
+            for (int i = 0; i < w; i++, out += bpp) {
+                int v[4] = { row[0][2 * i], row[0][2 * i + 1], row[1][2 * i], row[1][2 * i + 1] };
+                out[0] = (unsigned char)v[r_off];
+                out[1] = (unsigned char)((v[g1] + v[g2] + 1) >> 1);
+                out[2] = (unsigned char)v[b_off];
+                if (bpp == 4) out[3] = 255;
+            }
+        } else {
+            const unsigned char *row[2] = { src->data + (size_t)(2 * j) * src->width * 2,
+                                            src->data + (size_t)(2 * j + 1) * src->width * 2 };
+            for (int i = 0; i < w; i++, out += bpp) {
+                const unsigned char *a = row[0] + 4 * i, *b = row[1] + 4 * i;
+                int v[4] = { (a[0] | (a[1] << 8)) & 0x3FF, (a[2] | (a[3] << 8)) & 0x3FF,
+                             (b[0] | (b[1] << 8)) & 0x3FF, (b[2] | (b[3] << 8)) & 0x3FF };
+                out[0] = (unsigned char)(v[r_off] >> 2);
+                out[1] = (unsigned char)((v[g1] + v[g2] + 1) >> 3);
+                out[2] = (unsigned char)(v[b_off] >> 2);
+                if (bpp == 4) out[3] = 255;
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+WEBCAM_API int webcam_demosaic(Webcam *cam, const WebcamFrame *src, WebcamDemosaicMode mode,
+                               unsigned char *dst, WebcamPixelFormat dst_format,
+                               WebcamFrame *out) {
+    int bpp = dst_format == WEBCAM_FMT_RGB24 ? 3 : (dst_format == WEBCAM_FMT_RGB32 ? 4 : 0);
+    if (!webcam_frame_valid(src) || !webcam_is_bayer(src->format) || !dst || !bpp) return -1;
+    if ((src->width & 1) || (src->height & 1) || src->width < 4 || src->height < 4) return -1;
+
+    DemosaicJob job = { src, mode, dst, bpp, 0 };
+    int w = src->width, h = src->height;
+    switch (mode) {
+        case WEBCAM_DEMOSAIC_BILINEAR:
+        case WEBCAM_DEMOSAIC_EDGE:
+            webcam_parallel_rows(webcam_get_workers(cam), h, demosaic_rows, &job);
+            break;
+        case WEBCAM_DEMOSAIC_HALF:
+            w /= 2;
+            h /= 2;
+            webcam_parallel_rows(webcam_get_workers(cam), h, half_rows, &job);
+            break;
+        default:
+            return -1;
+    }
+    if (job.failed) return -1;
+
+    if (out) {
+        *out = *src;
+        out->data = dst;
+        out->width = w;
+        out->height = h;
+        out->format = dst_format;
+        out->size = (int)webcam_frame_size(dst_format, w, h);
+    }
+    return 0;
+}
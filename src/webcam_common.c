@@ -1,7 +1,8 @@
 // ============================================================================
 // webcam_common.c
 // ============================================================================
-#include "webcam.h"
+#include "webcam_internal.h"
+#include <string.h>
 #include <stdlib.h>
 
 WEBCAM_API void webcam_free_list(WebcamInfo *list) {
@@ -15,6 +16,29 @@ WEBCAM_API void webcam_free_capabilities(WebcamCapabilities *caps) {
     }
 }
 
+WEBCAM_API size_t webcam_frame_size(WebcamPixelFormat format, int width, int height) {
+    if (width <= 0 || height <= 0) return 0;
+    size_t pixels = (size_t)width * height;
+    switch (format) {
+        case WEBCAM_FMT_RGB24:  return pixels * 3;
+        case WEBCAM_FMT_RGB32:  return pixels * 4;
+        case WEBCAM_FMT_YUYV:   return pixels * 2;
+        case WEBCAM_FMT_YUV420: return pixels * 3 / 2;
+        case WEBCAM_FMT_MJPEG:  return pixels * 3;
+        case WEBCAM_FMT_NV12:   return pixels * 3 / 2;
+        case WEBCAM_FMT_GRAY8:  return pixels;
+        case WEBCAM_FMT_SRGGB8:
+        case WEBCAM_FMT_SBGGR8:
+        case WEBCAM_FMT_SGRBG8:
+        case WEBCAM_FMT_SGBRG8:  return pixels;
+        case WEBCAM_FMT_SRGGB10:
+        case WEBCAM_FMT_SBGGR10:
+        case WEBCAM_FMT_SGRBG10:
+        case WEBCAM_FMT_SGBRG10: return pixels * 2;
+    }
+    return 0;
+}
+
 WEBCAM_API WebcamFormatInfo* webcam_find_best_format(
     WebcamCapabilities *caps,
     int preferred_width,
@@ -44,3 +68,25 @@ WEBCAM_API WebcamFormatInfo* webcam_find_best_format(
     
     return best;
 }
+
+void webcam_decimator_set(WebcamDecimator *d, int every_nth, int max_fps) {
+    memset(d, 0, sizeof(*d));
+    d->every_nth = every_nth;
+    d->interval_us = max_fps > 0 ? 1000000u / max_fps : 0;
+}
+
+int webcam_decimator_skip(WebcamDecimator *d, uint64_t ts_us) {
+    uint64_t gap = d->last_us && ts_us > d->last_us ? ts_us - d->last_us : 0;
+    d->last_us = ts_us;
+    if (d->every_nth > 1 && d->count++ % d->every_nth) return 1;
+    if (!d->interval_us) return 0;
+
+    // Half a source interval of slack, so jitter does not push a frame that
+    // is due into the next slot
+    if (d->next_us && ts_us + gap / 2 < d->next_us) return 1;
+    if (d->next_us && ts_us < d->next_us + d->interval_us)
+        d->next_us += d->interval_us;       // On schedule: no drift
+    else
+        d->next_us = ts_us + d->interval_us;
+    return 0;
+}
@@ -0,0 +1,163 @@
+// ============================================================================
+// webcam_control.c - Thread-safe control updates, concurrent with capture
+// ============================================================================
+// Setters push onto a bounded ring (one sequence number per slot, so producers
+// claim tickets with a single CAS and never lock). Changes are written to the
+// driver in ticket order by whichever thread wins the drain flag: usually the
+// setter itself, or the capture thread when the setter only queued. A thread
+// that loses the flag leaves the work to the winner instead of waiting.
+//
+// Each applied change bumps the generation and records when it happened, so
+// frames are labelled with the newest generation applied before they were
+// captured. Setters wait (yielding) until their own change is applied and
+// read its result; only the capture path never waits.
+// ============================================================================
+#include "webcam_internal.h"
+
+#if defined(_WIN32)
+  #include <windows.h>
+  #define yield_thread() SwitchToThread()
+#else
+  #include <sched.h>
+  #define yield_thread() sched_yield()
+#endif
+
+#define SLOT_MASK    (WEBCAM_CONTROL_SLOTS - 1)
+#define HISTORY_MASK (WEBCAM_CONTROL_HISTORY - 1)
+
+void webcam_controls_init(WebcamControls *c) {
+    for (int i = 0; i < WEBCAM_CONTROL_SLOTS; i++) c->slots[i].seq = (atomic_int32)i;
+    c->tail = c->head = c->applied = c->draining = 0;
+    for (int i = 0; i < WEBCAM_CONTROL_SLOTS; i++) c->result[i] = 0;
+    for (int i = 0; i < WEBCAM_CONTROL_HISTORY; i++) c->applied_us[i] = 0;
+}
+
+static int controls_push(WebcamControls *c, WebcamParameter param, long value, int set_auto,
+                         uint32_t *generation) {
+    atomic_int32 pos = atomic_load_32(&c->tail);
+    for (;;) {
+        int32_t diff = (int32_t)((uint32_t)atomic_load_32(&c->slots[(uint32_t)pos & SLOT_MASK].seq) -
+                                 (uint32_t)pos);
+        if (diff == 0) {
+            if (atomic_cas_32(&c->tail, &pos, (atomic_int32)((uint32_t)pos + 1))) break;
+        } else if (diff < 0) {
+            return -2;  // Full: the drainer is WEBCAM_CONTROL_SLOTS changes behind
+        } else {
+            pos = atomic_load_32(&c->tail);
+        }
+    }
+
+    uint32_t ticket = (uint32_t)pos;
+    c->slots[ticket & SLOT_MASK].param = param;
+    c->slots[ticket & SLOT_MASK].value = value;
+    c->slots[ticket & SLOT_MASK].set_auto = set_auto;
+    atomic_store_32(&c->slots[ticket & SLOT_MASK].seq, (atomic_int32)(ticket + 1));
+    if (generation) *generation = ticket + 1;
+    return 0;
+}
+
+// Applies every complete change in order; returns how many. Holds the drain flag.
+static int controls_drain(Webcam *cam, WebcamControls *c) {
+    uint32_t head = (uint32_t)atomic_relaxed_load_32(&c->head);
+    int applied = 0;
+    for (;;) {
+        // A claimed slot still being written stops the drain; its setter
+        // retries once it is done
+        if ((uint32_t)atomic_load_32(&c->slots[head & SLOT_MASK].seq) != head + 1) break;
+        WebcamParameter param = (WebcamParameter)c->slots[head & SLOT_MASK].param;
+        long value = c->slots[head & SLOT_MASK].value;
+        int set_auto = c->slots[head & SLOT_MASK].set_auto;
+        atomic_store_32(&c->slots[head & SLOT_MASK].seq,
+                        (atomic_int32)(head + WEBCAM_CONTROL_SLOTS));
+        head++;
+        atomic_store_32(&c->head, (atomic_int32)head);
+
+        int rejected = webcam_apply_control(cam, param, value, set_auto) != 0;
+        atomic_store_32(&c->result[head & SLOT_MASK], (atomic_int32)((head << 1) | (uint32_t)rejected));
+        atomic_store_64(&c->applied_us[head & HISTORY_MASK], (int64_t)webcam_now_us());
+        atomic_store_32(&c->applied, (atomic_int32)head);
+        applied++;
+    }
+    return applied;
+}
+
+void webcam_controls_apply(Webcam *cam) {
+    WebcamControls *c = webcam_get_controls(cam);
+    while (atomic_relaxed_load_32(&c->tail) != atomic_relaxed_load_32(&c->head)) {
+        if (atomic_exchange_32(&c->draining, 1)) return;  // The holder applies them
+        int progress = controls_drain(cam, c);
+        // An exchange, not a store: a setter that lost the flag meanwhile
+        // published its change before its own exchange, so the recheck sees it
+        atomic_exchange_32(&c->draining, 0);
+        if (!progress) return;
+    }
+}
+
+uint32_t webcam_controls_at(WebcamControls *c, uint64_t ts_us) {
+    for (;;) {
+        uint32_t newest = (uint32_t)atomic_load_32(&c->applied);
+        uint32_t gen = newest, n = 0, oldest_read = 0;
+        // Frames older than the history get its oldest generation
+        while (gen && n < WEBCAM_CONTROL_HISTORY - 1) {
+            if ((uint64_t)atomic_load_64(&c->applied_us[gen & HISTORY_MASK]) <= ts_us) {
+                oldest_read = 1;
+                break;
+            }
+            gen--;
+            n++;
+        }
+        // Retry if the drainer lapped the entries read meanwhile (rare). It
+        // writes entry applied + 1 before publishing applied, so that entry
+        // must not be one of them either.
+        if ((uint32_t)atomic_load_32(&c->applied) - newest < WEBCAM_CONTROL_HISTORY - n - oldest_read)
+            return gen;
+    }
+}
+
+static int queue_control(Webcam *cam, WebcamParameter param, long value, int set_auto,
+                         uint32_t *generation) {
+    if (!cam || param < WEBCAM_PARAM_BRIGHTNESS || param > WEBCAM_PARAM_VFLIP) return -1;
+    if (set_auto && param != WEBCAM_PARAM_EXPOSURE && param != WEBCAM_PARAM_FOCUS) return -1;
+    return controls_push(webcam_get_controls(cam), param, value, set_auto, generation);
+}
+
+static int set_control(Webcam *cam, WebcamParameter param, long value, int set_auto) {
+    uint32_t gen;
+    int r = queue_control(cam, param, value, set_auto, &gen);
+    if (r != 0) return r;
+
+    // Another thread may hold the drain flag (or a change ahead of this one
+    // may still be being written): keep offering to drain until it is applied
+    WebcamControls *c = webcam_get_controls(cam);
+    for (;;) {
+        webcam_controls_apply(cam);
+        if ((int32_t)((uint32_t)atomic_load_32(&c->applied) - gen) >= 0) break;
+        yield_thread();
+    }
+    // The entry is reused WEBCAM_CONTROL_SLOTS changes later; if that already
+    // happened the outcome is gone and the change counts as applied
+    uint32_t result = (uint32_t)atomic_load_32(&c->result[gen & SLOT_MASK]);
+    return result == ((gen << 1) | 1u) ? -1 : 0;
+}
+
+WEBCAM_API int webcam_set_parameter(Webcam *cam, WebcamParameter param, long value) {
+    return set_control(cam, param, value, 0);
+}
+
+WEBCAM_API int webcam_set_auto(Webcam *cam, WebcamParameter param, int is_auto) {
+    return set_control(cam, param, is_auto ? 1 : 0, 1);
+}
+
+WEBCAM_API int webcam_queue_parameter(Webcam *cam, WebcamParameter param, long value,
+                                      uint32_t *generation) {
+    return queue_control(cam, param, value, 0, generation);
+}
+
+WEBCAM_API int webcam_queue_auto(Webcam *cam, WebcamParameter param, int is_auto,
+                                 uint32_t *generation) {
+    return queue_control(cam, param, is_auto ? 1 : 0, 1, generation);
+}
+
+WEBCAM_API uint32_t webcam_get_control_generation(Webcam *cam) {
+    return cam ? (uint32_t)atomic_load_32(&webcam_get_controls(cam)->applied) : 0;
+}
@@ -0,0 +1,258 @@
+// ============================================================================
+// webcam_convert.c - Color conversion, crop and scaling to RGB
+// ============================================================================
+// Every output row is a pure function of the source frame, so rows are split
+// into bands across the camera's worker pool and the result is bit-identical
+// for any thread count. Color math is BT.601 full range in 8.8 fixed point.
+// ============================================================================
+#include "webcam_internal.h"
+#include <string.h>
+
+static unsigned char clamp8(int v) {
+    return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// Chroma terms are shared by the two pixels of a YUYV pair / 2x2 YUV420-NV12 block
+typedef struct { int r, g, b; } Chroma;
+
+static Chroma chroma(int u, int v) {
+    Chroma c;
+    c.r = (359 * v + 128) >> 8;
+    c.g = (88 * u + 183 * v + 128) >> 8;
+    c.b = (454 * u + 128) >> 8;
+    return c;
+}
+
+static void put_pixel(unsigned char *out, int y, Chroma c, int bpp) {
+    out[0] = clamp8(y + c.r);
+    out[1] = clamp8(y - c.g);
+    out[2] = clamp8(y + c.b);
+    if (bpp == 4) out[3] = 255;
+}
+
+static void yuyv_row(const unsigned char *s, int x0, int w, unsigned char *out, int bpp) {
+    int x = x0, end = x0 + w;
+    if (x & 1) {
+        const unsigned char *p = s + (x >> 1) * 4;
+        put_pixel(out, p[2], chroma(p[1] - 128, p[3] - 128), bpp);
+        out += bpp; x++;
+    }
+    for (const unsigned char *p = s + (x >> 1) * 4; x + 1 < end; x += 2, p += 4) {
+        Chroma c = chroma(p[1] - 128, p[3] - 128);
+        put_pixel(out, p[0], c, bpp);
+        put_pixel(out + bpp, p[2], c, bpp);
+        out += 2 * bpp;
+    }
+    if (x < end) {
+        const unsigned char *p = s + (x >> 1) * 4;
+        put_pixel(out, p[0], chroma(p[1] - 128, p[3] - 128), bpp);
+    }
+}
+
+static void yuv420_row(const unsigned char *py, const unsigned char *pu,
+                       const unsigned char *pv, int x0, int w,
+                       unsigned char *out, int bpp) {
+    for (int x = x0; x < x0 + w; x++, out += bpp)
+        put_pixel(out, py[x], chroma(pu[x >> 1] - 128, pv[x >> 1] - 128), bpp);
+}
+
+static void nv12_row(const unsigned char *py, const unsigned char *puv, int x0, int w,
+                     unsigned char *out, int bpp) {
+    for (int x = x0; x < x0 + w; x++, out += bpp) {
+        const unsigned char *uv = puv + (x & ~1);
+        put_pixel(out, py[x], chroma(uv[0] - 128, uv[1] - 128), bpp);
+    }
+}
+
+// Convert `w` pixels of source row `y`, starting at column `x0`, to RGB with
+// `bpp` bytes per pixel (3, or 4 with opaque alpha).
+static void convert_row(const WebcamFrame *src, int y, int x0, int w,
+                        unsigned char *out, int bpp) {
+    const int W = src->width;
+    const unsigned char *s;
+
+    switch (src->format) {
+        case WEBCAM_FMT_RGB24:
+            s = src->data + ((size_t)y * W + x0) * 3;
+            if (bpp == 3) {
+                memcpy(out, s, (size_t)w * 3);
+                return;
+            }
+            for (int x = 0; x < w; x++, s += 3, out += 4) {
+                out[0] = s[0]; out[1] = s[1]; out[2] = s[2]; out[3] = 255;
+            }
+            return;
+
+        case WEBCAM_FMT_RGB32:
+            s = src->data + ((size_t)y * W + x0) * 4;
+            if (bpp == 4) {
+                memcpy(out, s, (size_t)w * 4);
+                return;
+            }
+            for (int x = 0; x < w; x++, s += 4, out += 3) {
+                out[0] = s[0]; out[1] = s[1]; out[2] = s[2];
+            }
+            return;
+
+        case WEBCAM_FMT_YUYV:
+            s = src->data + (size_t)y * W * 2;
+            // Constant bpp lets the compiler specialize the inner loop
+            if (bpp == 4) yuyv_row(s, x0, w, out, 4);
+            else yuyv_row(s, x0, w, out, 3);
+            return;
+
+        case WEBCAM_FMT_YUV420: {
+            const unsigned char *py = src->data + (size_t)y * W;
+            const unsigned char *pu = src->data + (size_t)W * src->height +
+                                      (size_t)(y >> 1) * (W >> 1);
+            const unsigned char *pv = pu + (size_t)(W >> 1) * (src->height >> 1);
+            if (bpp == 4) yuv420_row(py, pu, pv, x0, w, out, 4);
+            else yuv420_row(py, pu, pv, x0, w, out, 3);
+            return;
+        }
+
+        case WEBCAM_FMT_NV12: {
+            const unsigned char *py = src->data + (size_t)y * W;
+            const unsigned char *puv = src->data + (size_t)W * src->height +
+                                       (size_t)(y >> 1) * W;
+            if (bpp == 4) nv12_row(py, puv, x0, w, out, 4);
+            else nv12_row(py, puv, x0, w, out, 3);
+            return;
+        }
+
+        case WEBCAM_FMT_GRAY8:
+            s = src->data + (size_t)y * W + x0;
+            for (int x = 0; x < w; x++, out += bpp) {
+                out[0] = out[1] = out[2] = s[x];
+                if (bpp == 4) out[3] = 255;
+            }
+            return;
+
+        default:
+            if (webcam_is_bayer(src->format)) webcam_bayer_row(src, y, x0, w, out, bpp);
+            return;
+    }
+}
+
+int webcam_frame_valid(const WebcamFrame *src) {
+    if (!src || !src->data || src->width <= 0 || src->height <= 0) return 0;
+    if (src->width > MAX_ROW_WIDTH || src->format == WEBCAM_FMT_MJPEG) return 0;
+    return (size_t)src->size >= webcam_frame_size(src->format, src->width, src->height);
+}
+
+static int dst_bpp(WebcamPixelFormat format) {
+    if (format == WEBCAM_FMT_RGB24) return 3;
+    if (format == WEBCAM_FMT_RGB32) return 4;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Crop (and full-frame convert)
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const WebcamFrame *src;
+    int x, y, w;
+    unsigned char *dst;
+    int bpp;
+} CropJob;
+
+static void crop_rows(void *ctx, int begin, int end) {
+    CropJob *job = (CropJob*)ctx;
+    size_t stride = (size_t)job->w * job->bpp;
+    for (int r = begin; r < end; r++)
+        convert_row(job->src, job->y + r, job->x, job->w, job->dst + r * stride, job->bpp);
+}
+
+WEBCAM_API int webcam_crop(Webcam *cam, const WebcamFrame *src, int x, int y,
+                           int width, int height, unsigned char *dst,
+                           WebcamPixelFormat dst_format) {
+    int bpp = dst_bpp(dst_format);
+    if (!webcam_frame_valid(src) || !dst || !bpp) return -1;
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        x + width > src->width || y + height > src->height) return -1;
+
+    CropJob job = { src, x, y, width, dst, bpp };
+    webcam_parallel_rows(webcam_get_workers(cam), height, crop_rows, &job);
+    return 0;
+}
+
+WEBCAM_API int webcam_convert(Webcam *cam, const WebcamFrame *src, unsigned char *dst,
+                              WebcamPixelFormat dst_format) {
+    if (!src) return -1;
+    return webcam_crop(cam, src, 0, 0, src->width, src->height, dst, dst_format);
+}
+
+// ---------------------------------------------------------------------------
+// Bilinear scale, 16.16 source coordinates, pixel centers aligned
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const WebcamFrame *src;
+    unsigned char *dst;
+    int dst_w, dst_h;
+    int bpp;
+} ScaleJob;
+
+int webcam_src_coord(int d, int src_len, int dst_len) {
+    long long c = ((long long)(2 * d + 1) * src_len << 16) / (2 * dst_len) - 32768;
+    if (c < 0) c = 0;
+    if (c > ((long long)(src_len - 1) << 16)) c = (long long)(src_len - 1) << 16;
+    return (int)c;
+}
+
+static void scale_rows(void *ctx, int begin, int end) {
+    ScaleJob *job = (ScaleJob*)ctx;
+    const WebcamFrame *src = job->src;
+    const int sw = src->width, sh = src->height, bpp = job->bpp;
+    unsigned char rows[2][MAX_ROW_WIDTH * 3];
+    int cached[2] = { -1, -1 };
+
+    for (int r = begin; r < end; r++) {
+        int sy = webcam_src_coord(r, sh, job->dst_h);
+        int y0 = sy >> 16;
+        int y1 = y0 + 1 < sh ? y0 + 1 : y0;
+        int fy = (sy >> 8) & 255;
+
+        // Rows advance monotonically, so the old bottom row is often the new top
+        if (cached[0] != y0) {
+            if (cached[1] == y0) {
+                memcpy(rows[0], rows[1], (size_t)sw * 3);
+            } else {
+                convert_row(src, y0, 0, sw, rows[0], 3);
+            }
+            cached[0] = y0;
+        }
+        if (cached[1] != y1) {
+            convert_row(src, y1, 0, sw, rows[1], 3);
+            cached[1] = y1;
+        }
+
+        unsigned char *out = job->dst + (size_t)r * job->dst_w * bpp;
+        for (int c = 0; c < job->dst_w; c++, out += bpp) {
+            int sx = webcam_src_coord(c, sw, job->dst_w);
+            int x0 = sx >> 16;
+            int x1 = x0 + 1 < sw ? x0 + 1 : x0;
+            int fx = (sx >> 8) & 255;
+            const unsigned char *a = rows[0] + x0 * 3, *b = rows[0] + x1 * 3;
+            const unsigned char *cc = rows[1] + x0 * 3, *d = rows[1] + x1 * 3;
+            for (int k = 0; k < 3; k++) {
+                int top = a[k] * (256 - fx) + b[k] * fx;
+                int bot = cc[k] * (256 - fx) + d[k] * fx;
+                out[k] = (unsigned char)((top * (256 - fy) + bot * fy + 32768) >> 16);
+            }
+            if (bpp == 4) out[3] = 255;
+        }
+    }
+}
+
+WEBCAM_API int webcam_scale(Webcam *cam, const WebcamFrame *src, unsigned char *dst,
+                            int dst_width, int dst_height, WebcamPixelFormat dst_format) {
+    int bpp = dst_bpp(dst_format);
+    if (!webcam_frame_valid(src) || !dst || !bpp || dst_width <= 0 || dst_height <= 0)
+        return -1;
+
+    ScaleJob job = { src, dst, dst_width, dst_height, bpp };
+    webcam_parallel_rows(webcam_get_workers(cam), dst_height, scale_rows, &job);
+    return 0;
+}
@@ -0,0 +1,606 @@
+// ============================================================================
+// webcam_history.c - Pre-event history buffer (time-bounded frame ring)
+// ============================================================================
+// Frames are appended to one byte ring allocated at creation, next to a fixed
+// table of entry slots and, when the camera's geometry is known, the coding
+// scratch for its frames, all charged to the budget. MJPEG is stored as-is; raw frames are coded
+// losslessly (MED prediction as in JPEG-LS, then groups of 16 residuals
+// stored as bit-planes) after an optional downscale to RGB24. A trigger pins
+// the current window and a delivery thread decodes it into the callback while
+// new frames keep arriving around it: push never waits for the consumer, it
+// only skips frames if the pinned part leaves no room.
+// ============================================================================
+#include "webcam_internal.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+  typedef HANDLE history_thread_t;
+  typedef CRITICAL_SECTION history_mutex_t;
+  typedef CONDITION_VARIABLE history_cond_t;
+  #define mutex_init(m)       InitializeCriticalSection(m)
+  #define mutex_destroy(m)    DeleteCriticalSection(m)
+  #define mutex_lock(m)       EnterCriticalSection(m)
+  #define mutex_unlock(m)     LeaveCriticalSection(m)
+  #define cond_init(c)        InitializeConditionVariable(c)
+  #define cond_destroy(c)     ((void)0)
+  #define cond_wait(c, m)     SleepConditionVariableCS((c), (m), INFINITE)
+  #define cond_signal(c)      WakeConditionVariable(c)
+#else
+  #include <pthread.h>
+  typedef pthread_t history_thread_t;
+  typedef pthread_mutex_t history_mutex_t;
+  typedef pthread_cond_t history_cond_t;
+  #define mutex_init(m)       pthread_mutex_init((m), NULL)
+  #define mutex_destroy(m)    pthread_mutex_destroy(m)
+  #define mutex_lock(m)       pthread_mutex_lock(m)
+  #define mutex_unlock(m)     pthread_mutex_unlock(m)
+  #define cond_init(c)        pthread_cond_init((c), NULL)
+  #define cond_destroy(c)     pthread_cond_destroy(c)
+  #define cond_wait(c, m)     pthread_cond_wait((c), (m))
+  #define cond_signal(c)      pthread_cond_signal(c)
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define HISTORY_SSE2 1
+#endif
+
+#define GROUP 16                    // Residuals per bit-plane group
+#define MAX_CODED_ROW (MAX_ROW_WIDTH * 4)
+#define NO_PIN ULONG_MAX
+#define ENTRY_SHARE 4096            // Budget bytes per entry slot
+#define MIN_ENTRIES 64
+
+// ---------------------------------------------------------------------------
+// Lossless raw coding
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    size_t offset;
+    int row_bytes;
+    int rows;
+    int step;                   // Bytes to the same component on the left
+    int up;                     // Rows to the same component above
+} CodedPlane;
+
+static int coded_planes(const WebcamFrame *f, CodedPlane p[3]) {
+    const int W = f->width, H = f->height;
+    const size_t luma = (size_t)W * H;
+    CodedPlane one = { 0, W, H, 1, 1 };
+    p[0] = one;
+    switch (f->format) {
+        case WEBCAM_FMT_RGB24:  p[0].row_bytes = W * 3; p[0].step = 3; return 1;
+        case WEBCAM_FMT_RGB32:  p[0].row_bytes = W * 4; p[0].step = 4; return 1;
+        case WEBCAM_FMT_YUYV:   p[0].row_bytes = W * 2; p[0].step = 4; return 1;
+        case WEBCAM_FMT_GRAY8:  return 1;
+        case WEBCAM_FMT_YUV420:
+            p[1].offset = luma;
+            p[1].row_bytes = W / 2;
+            p[1].rows = H / 2;
+            p[1].step = p[1].up = 1;
+            p[2] = p[1];
+            p[2].offset = luma + (size_t)(W / 2) * (H / 2);
+            return 3;
+        case WEBCAM_FMT_NV12:
+            p[1].offset = luma;
+            p[1].row_bytes = W;
+            p[1].rows = H / 2;
+            p[1].step = 2;
+            p[1].up = 1;
+            return 2;
+        default:
+            if (!webcam_is_bayer(f->format)) return 0;
+            // Same color sits two columns / rows away
+            p[0].up = 2;
+            p[0].step = webcam_frame_size(f->format, 1, 1) == 2 ? 4 : 2;
+            p[0].row_bytes = W * (p[0].step / 2);
+            return 1;
+    }
+}
+
+static size_t coded_bound(const WebcamFrame *f) {
+    CodedPlane p[3];
+    int n = coded_planes(f, p);
+    size_t bound = 0;
+    for (int i = 0; i < n; i++)
+        bound += (size_t)p[i].rows * ((p[i].row_bytes + GROUP - 1) / GROUP) * (GROUP + 1);
+    return bound;
+}
+
+static int med(int a, int b, int c) {
+    int mn = a < b ? a : b, mx = a < b ? b : a;
+    if (c >= mx) return mn;
+    if (c <= mn) return mx;
+    return a + b - c;
+}
+
+// Signed byte residual -> 0, 1, 2... for -0, -1, 1, -2...
+static unsigned char zigzag(int r) {
+    signed char s = (signed char)r;
+    return (unsigned char)(((unsigned)s << 1) ^ (s < 0 ? 0xFF : 0));
+}
+
+static int unzigzag(unsigned char z) {
+    return (z >> 1) ^ -(z & 1);
+}
+
+static void residual_row(const unsigned char *cur, const unsigned char *up, int n, int step,
+                         unsigned char *z) {
+    int x = 0;
+    if (!up) {
+        for (; x < n && x < step; x++) z[x] = zigzag(cur[x]);
+        for (; x < n; x++) z[x] = zigzag(cur[x] - cur[x - step]);
+        return;
+    }
+    for (; x < n && x < step; x++) z[x] = zigzag(cur[x] - up[x]);
+#ifdef HISTORY_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= n; x += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(cur + x - step));
+        __m128i b = _mm_loadu_si128((const __m128i*)(up + x));
+        __m128i c = _mm_loadu_si128((const __m128i*)(up + x - step));
+        __m128i mn = _mm_min_epu8(a, b), mx = _mm_max_epu8(a, b);
+        __m128i ge = _mm_cmpeq_epi8(_mm_max_epu8(c, mx), c);
+        __m128i le = _mm_cmpeq_epi8(_mm_min_epu8(c, mn), c);
+        __m128i grad = _mm_sub_epi8(_mm_add_epi8(a, b), c);
+        __m128i pred = _mm_or_si128(_mm_and_si128(le, mx), _mm_andnot_si128(le, grad));
+        pred = _mm_or_si128(_mm_and_si128(ge, mn), _mm_andnot_si128(ge, pred));
+        __m128i r = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(cur + x)), pred);
+        __m128i zz = _mm_xor_si128(_mm_add_epi8(r, r), _mm_cmpgt_epi8(zero, r));
+        _mm_storeu_si128((__m128i*)(z + x), zz);
+    }
+#endif
+    for (; x < n; x++) z[x] = zigzag(cur[x] - med(cur[x - step], up[x], up[x - step]));
+}
+
+// One byte with the bit count b, then b 16-bit planes (bit k of each residual)
+static unsigned char* pack_group(const unsigned char *z, unsigned char *out) {
+    unsigned planes[8];
+    int bits = 0;
+#ifdef HISTORY_SSE2
+    __m128i v = _mm_loadu_si128((const __m128i*)z);
+    #define PLANE(k) planes[k] = (unsigned)_mm_movemask_epi8(_mm_slli_epi16(v, 7 - (k)))
+    PLANE(0); PLANE(1); PLANE(2); PLANE(3); PLANE(4); PLANE(5); PLANE(6); PLANE(7);
+    #undef PLANE
+#else
+    for (int k = 0; k < 8; k++) {
+        planes[k] = 0;
+        for (int i = 0; i < GROUP; i++) planes[k] |= (unsigned)((z[i] >> k) & 1) << i;
+    }
+#endif
+    for (int k = 0; k < 8; k++)
+        if (planes[k]) bits = k + 1;
+    *out++ = (unsigned char)bits;
+    for (int k = 0; k < bits; k++) {
+        *out++ = (unsigned char)planes[k];
+        *out++ = (unsigned char)(planes[k] >> 8);
+    }
+    return out;
+}
+
+static const unsigned char* unpack_group(const unsigned char *in, const unsigned char *end,
+                                         unsigned char *z) {
+    if (in >= end) return NULL;
+    int bits = *in++;
+    if (bits > 8 || end - in < 2 * bits) return NULL;
+    memset(z, 0, GROUP);
+    for (int k = 0; k < bits; k++, in += 2) {
+        unsigned m = in[0] | (in[1] << 8);
+        for (int i = 0; m; i++, m >>= 1) z[i] |= (unsigned char)((m & 1) << k);
+    }
+    return in;
+}
+
+static size_t encode_frame(const WebcamFrame *f, unsigned char *dst) {
+    unsigned char z[MAX_CODED_ROW + GROUP];
+    CodedPlane p[3];
+    int n = coded_planes(f, p);
+    unsigned char *out = dst;
+    for (int i = 0; i < n; i++) {
+        const unsigned char *base = f->data + p[i].offset;
+        for (int y = 0; y < p[i].rows; y++) {
+            const unsigned char *cur = base + (size_t)y * p[i].row_bytes;
+            const unsigned char *up = y >= p[i].up ? cur - (size_t)p[i].up * p[i].row_bytes : NULL;
+            residual_row(cur, up, p[i].row_bytes, p[i].step, z);
+            memset(z + p[i].row_bytes, 0, GROUP);
+            for (int x = 0; x < p[i].row_bytes; x += GROUP) out = pack_group(z + x, out);
+        }
+    }
+    return (size_t)(out - dst);
+}
+
+static int decode_frame(const unsigned char *src, size_t size, const WebcamFrame *f,
+                        unsigned char *dst) {
+    unsigned char z[MAX_CODED_ROW + GROUP];
+    const unsigned char *in = src, *end = src + size;
+    CodedPlane p[3];
+    int n = coded_planes(f, p);
+    size_t covered = 0;
+    for (int i = 0; i < n; i++) {
+        unsigned char *base = dst + p[i].offset;
+        const int rb = p[i].row_bytes, step = p[i].step;
+        for (int y = 0; y < p[i].rows; y++) {
+            for (int x = 0; x < rb; x += GROUP)
+                if (!(in = unpack_group(in, end, z + x))) return -1;
+
+            unsigned char *cur = base + (size_t)y * rb;
+            const unsigned char *up = y >= p[i].up ? cur - (size_t)p[i].up * rb : NULL;
+            for (int x = 0; x < rb; x++) {
+                int pred;
+                if (!up) pred = x < step ? 0 : cur[x - step];
+                else pred = x < step ? up[x] : med(cur[x - step], up[x], up[x - step]);
+                cur[x] = (unsigned char)(pred + unzigzag(z[x]));
+            }
+        }
+        covered = p[i].offset + (size_t)rb * p[i].rows;
+    }
+    size_t total = webcam_frame_size(f->format, f->width, f->height);
+    if (total > covered) memset(dst + covered, 0, total - covered);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Ring
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    size_t offset;
+    size_t size;                // Stored bytes
+    WebcamFrame frame;          // What the entry decodes to (data unset)
+    int coded;                  // 0 = stored as-is (MJPEG)
+    unsigned long seq;
+} HistoryEntry;
+
+struct WebcamHistory {
+    Webcam *cam;
+    unsigned char *ring;
+    size_t ring_size;
+    uint64_t window_us;
+    int raw_scale;
+
+    history_mutex_t lock;
+    history_cond_t wake;
+    HistoryEntry *entries;      // Circular, oldest at head, fixed size
+    int entry_cap;
+    int head;
+    int count;
+    size_t write;               // End of the newest entry
+    unsigned long seq;
+
+    // Push side scratch (single producer)
+    unsigned char *coded;
+    size_t coded_cap;
+    unsigned char *scaled;
+    size_t scaled_cap;
+
+    // Snapshot in delivery; entries with seq >= pin are never evicted
+    unsigned long pin;
+    unsigned long snap_begin;
+    unsigned long snap_end;
+    WebcamHistoryCallback callback;
+    void *user;
+    int busy;
+    int quit;
+    int thread_started;
+    history_thread_t thread;
+    unsigned char *decoded;     // Delivery side
+    size_t decoded_cap;
+
+    WebcamHistoryStats stats;
+};
+
+static int grow(unsigned char **buf, size_t *cap, size_t need) {
+    if (need <= *cap) return 0;
+    unsigned char *p = (unsigned char*)realloc(*buf, need);
+    if (!p) return -1;
+    *buf = p;
+    *cap = need;
+    return 0;
+}
+
+// Scratch beyond what create reserved (frames larger than the camera's, or
+// no camera given) comes on top of the budget and shows in memory_bytes
+static int grow_scratch(WebcamHistory *h, unsigned char **buf, size_t *cap, size_t need) {
+    size_t before = *cap;
+    if (grow(buf, cap, need) < 0) return -1;
+    if (*cap != before) {
+        mutex_lock(&h->lock);
+        h->stats.memory_bytes += *cap - before;
+        mutex_unlock(&h->lock);
+    }
+    return 0;
+}
+
+// Geometry a raw frame is stored at
+static void stored_size(int raw_scale, int width, int height, int *w, int *ht) {
+    *w = raw_scale > 1 ? width / raw_scale : width;
+    *ht = raw_scale > 1 ? height / raw_scale : height;
+    if (*w < 1) *w = 1;
+    if (*ht < 1) *ht = 1;
+}
+
+static HistoryEntry* entry_at(WebcamHistory *h, int i) {
+    return &h->entries[(h->head + i) % h->entry_cap];
+}
+
+// Entry holding seq, or NULL once evicted
+static HistoryEntry* entry_by_seq(WebcamHistory *h, unsigned long seq) {
+    if (!h->count) return NULL;
+    unsigned long oldest = entry_at(h, 0)->seq;
+    if (seq < oldest || seq - oldest >= (unsigned long)h->count) return NULL;
+    return entry_at(h, (int)(seq - oldest));
+}
+
+static int evict_oldest(WebcamHistory *h) {
+    if (!h->count) return 0;
+    HistoryEntry *e = entry_at(h, 0);
+    if (e->seq >= h->pin) return 0;
+    h->stats.bytes_used -= e->size;
+    h->head = (h->head + 1) % h->entry_cap;
+    if (--h->count == 0) h->write = 0;
+    return 1;
+}
+
+// Free offset for n contiguous bytes, without evicting anything
+static int ring_fit(WebcamHistory *h, size_t n, size_t *at) {
+    if (!h->count) {
+        *at = 0;
+        return n <= h->ring_size;
+    }
+    size_t read = entry_at(h, 0)->offset;
+    if (read < h->write) {
+        if (h->ring_size - h->write >= n) { *at = h->write; return 1; }
+        if (read >= n) { *at = 0; return 1; }
+        return 0;
+    }
+    if (read > h->write && read - h->write >= n) { *at = h->write; return 1; }
+    return 0;
+}
+
+
+// ---------------------------------------------------------------------------
+// Delivery
+// ---------------------------------------------------------------------------
+
+#if defined(_WIN32)
+static DWORD WINAPI history_main(LPVOID param)
+#else
+static void* history_main(void *param)
+#endif
+{
+    WebcamHistory *h = (WebcamHistory*)param;
+
+    mutex_lock(&h->lock);
+    for (;;) {
+        while (!h->busy && !h->quit) cond_wait(&h->wake, &h->lock);
+        if (h->quit) break;
+
+        while (h->pin < h->snap_end && !h->quit) {
+            HistoryEntry *p = entry_by_seq(h, h->pin);
+            if (!p) break;              // Cannot happen while pinned
+            HistoryEntry e = *p;
+            int index = (int)(h->pin - h->snap_begin), count = (int)(h->snap_end - h->snap_begin);
+            mutex_unlock(&h->lock);
+
+            // The pinned bytes are not touched by push, so read them unlocked
+            WebcamFrame frame = e.frame;
+            int ok = 1;
+            if (!e.coded) {
+                frame.data = h->ring + e.offset;
+            } else if (grow_scratch(h, &h->decoded, &h->decoded_cap, (size_t)e.frame.size) == 0 &&
+                       decode_frame(h->ring + e.offset, e.size, &e.frame, h->decoded) == 0) {
+                frame.data = h->decoded;
+            } else {
+                ok = 0;
+            }
+            if (ok) h->callback(h->user, &frame, index, count);
+
+            mutex_lock(&h->lock);
+            h->pin++;
+        }
+        h->pin = NO_PIN;
+        h->busy = 0;
+        h->stats.snapshots++;
+    }
+    mutex_unlock(&h->lock);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+WEBCAM_API WebcamHistory* webcam_history_create(Webcam *cam, size_t memory_bytes,
+                                                int window_ms, int raw_scale) {
+    if (memory_bytes == 0 || window_ms < 0 || raw_scale < 0) return NULL;
+
+    WebcamHistory *h = (WebcamHistory*)calloc(1, sizeof(WebcamHistory));
+    if (!h) return NULL;
+    h->cam = cam;
+    h->raw_scale = raw_scale > 1 ? raw_scale : 1;
+
+    // Entry slots and the raw path's scratch come out of the budget
+    size_t slots = memory_bytes / ENTRY_SHARE;
+    h->entry_cap = slots < MIN_ENTRIES ? MIN_ENTRIES : slots > INT_MAX / 2 ? INT_MAX / 2 : (int)slots;
+    size_t scaled = 0, coded = 0, decoded = 0;
+    WebcamPixelFormat format = cam ? webcam_get_format(cam) : WEBCAM_FMT_MJPEG;
+    if (format != WEBCAM_FMT_MJPEG && webcam_get_actual_width(cam) > 0) {
+        WebcamFrame f;
+        memset(&f, 0, sizeof(f));
+        f.format = format;
+        stored_size(h->raw_scale, webcam_get_actual_width(cam), webcam_get_actual_height(cam),
+                    &f.width, &f.height);
+        if (h->raw_scale > 1) {
+            f.format = WEBCAM_FMT_RGB24;
+            scaled = webcam_frame_size(f.format, f.width, f.height);
+        }
+        coded = coded_bound(&f);
+        decoded = webcam_frame_size(f.format, f.width, f.height);
+    }
+    size_t fixed = (size_t)h->entry_cap * sizeof(HistoryEntry) + scaled + coded + decoded;
+    if (fixed >= memory_bytes) {
+        free(h);
+        return NULL;
+    }
+
+    h->ring_size = memory_bytes - fixed;
+    h->ring = (unsigned char*)malloc(h->ring_size);
+    h->entries = (HistoryEntry*)malloc((size_t)h->entry_cap * sizeof(HistoryEntry));
+    if (!h->ring || !h->entries || grow(&h->scaled, &h->scaled_cap, scaled) < 0 ||
+        grow(&h->coded, &h->coded_cap, coded) < 0 || grow(&h->decoded, &h->decoded_cap, decoded) < 0) {
+        free(h->ring);
+        free(h->entries);
+        free(h->scaled);
+        free(h->coded);
+        free(h->decoded);
+        free(h);
+        return NULL;
+    }
+    h->window_us = (uint64_t)window_ms * 1000;
+    h->pin = NO_PIN;
+    h->stats.memory_bytes = memory_bytes;
+    mutex_init(&h->lock);
+    cond_init(&h->wake);
+    return h;
+}
+
+WEBCAM_API int webcam_history_push(WebcamHistory *h, const WebcamFrame *frame) {
+    if (!h || !frame || !frame->data || frame->size <= 0) return -1;
+
+    WebcamFrame desc = *frame;
+    const unsigned char *payload = frame->data;
+    size_t size = (size_t)frame->size;
+    int coded = 0;
+
+    if (frame->format != WEBCAM_FMT_MJPEG) {
+        if (!webcam_frame_valid(frame)) return -1;
+        if (h->raw_scale > 1) {
+            int w, ht;
+            stored_size(h->raw_scale, frame->width, frame->height, &w, &ht);
+            size_t need = webcam_frame_size(WEBCAM_FMT_RGB24, w, ht);
+            if (grow_scratch(h, &h->scaled, &h->scaled_cap, need) < 0) return -1;
+            if (webcam_scale(h->cam, frame, h->scaled, w, ht, WEBCAM_FMT_RGB24) != 0) return -1;
+            desc.data = h->scaled;
+            desc.width = w;
+            desc.height = ht;
+            desc.format = WEBCAM_FMT_RGB24;
+        }
+        desc.size = (int)webcam_frame_size(desc.format, desc.width, desc.height);
+        if (grow_scratch(h, &h->coded, &h->coded_cap, coded_bound(&desc)) < 0) return -1;
+        size = encode_frame(&desc, h->coded);
+        payload = h->coded;
+        coded = 1;
+    }
+    desc.data = NULL;
+
+    mutex_lock(&h->lock);
+    h->stats.pushed++;
+
+    // Age out, then make room; only a pinned snapshot can stop eviction
+    while (h->window_us && h->count &&
+           desc.timestamp_us > entry_at(h, 0)->frame.timestamp_us + h->window_us &&
+           evict_oldest(h)) {}
+    size_t at;
+    while (!ring_fit(h, size, &at) || h->count == h->entry_cap)
+        if (!evict_oldest(h)) break;
+    if (!ring_fit(h, size, &at) || h->count == h->entry_cap) {
+        h->stats.dropped++;
+        mutex_unlock(&h->lock);
+        return size > h->ring_size ? -1 : -2;
+    }
+
+    memcpy(h->ring + at, payload, size);
+    HistoryEntry *e = entry_at(h, h->count++);
+    e->offset = at;
+    e->size = size;
+    e->frame = desc;
+    e->coded = coded;
+    e->seq = ++h->seq;
+    h->write = at + size;
+    h->stats.bytes_used += size;
+    h->stats.input_bytes += (uint64_t)frame->size;
+    h->stats.stored_bytes += size;
+    mutex_unlock(&h->lock);
+    return 0;
+}
+
+WEBCAM_API int webcam_history_trigger(WebcamHistory *h, int pre_ms,
+                                      WebcamHistoryCallback callback, void *user) {
+    if (!h || !callback) return -1;
+
+    mutex_lock(&h->lock);
+    if (h->busy) {
+        mutex_unlock(&h->lock);
+        return -2;
+    }
+    if (!h->thread_started) {
+#if defined(_WIN32)
+        h->thread = CreateThread(NULL, 0, history_main, h, 0, NULL);
+        h->thread_started = h->thread != NULL;
+#else
+        h->thread_started = pthread_create(&h->thread, NULL, history_main, h) == 0;
+#endif
+        if (!h->thread_started) {
+            mutex_unlock(&h->lock);
+            return -1;
+        }
+    }
+
+    int first = 0;
+    if (pre_ms > 0 && h->count) {
+        uint64_t newest = entry_at(h, h->count - 1)->frame.timestamp_us;
+        uint64_t span = (uint64_t)pre_ms * 1000;
+        while (first < h->count && entry_at(h, first)->frame.timestamp_us + span < newest) first++;
+    }
+    int frames = h->count - first;
+    if (frames > 0) {
+        h->snap_begin = h->pin = entry_at(h, first)->seq;
+        h->snap_end = h->seq + 1;
+        h->callback = callback;
+        h->user = user;
+        h->busy = 1;
+        cond_signal(&h->wake);
+    }
+    mutex_unlock(&h->lock);
+    return frames;
+}
+
+WEBCAM_API void webcam_history_get_stats(WebcamHistory *h, WebcamHistoryStats *stats) {
+    if (!h || !stats) return;
+    mutex_lock(&h->lock);
+    *stats = h->stats;
+    stats->frames = h->count;
+    stats->span_us = h->count ? entry_at(h, h->count - 1)->frame.timestamp_us -
+                                entry_at(h, 0)->frame.timestamp_us : 0;
+    stats->delivering = h->busy;
+    mutex_unlock(&h->lock);
+}
+
+WEBCAM_API void webcam_history_destroy(WebcamHistory *h) {
+    if (!h) return;
+
+    mutex_lock(&h->lock);
+    h->quit = 1;
+    cond_signal(&h->wake);
+    mutex_unlock(&h->lock);
+    if (h->thread_started) {
+#if defined(_WIN32)
+        WaitForSingleObject(h->thread, INFINITE);
+        CloseHandle(h->thread);
+#else
+        pthread_join(h->thread, NULL);
+#endif
+    }
+
+    cond_destroy(&h->wake);
+    mutex_destroy(&h->lock);
+    free(h->entries);
+    free(h->coded);
+    free(h->scaled);
+    free(h->decoded);
+    free(h->ring);
+    free(h);
+}
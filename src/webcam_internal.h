@@ -0,0 +1,168 @@
+// ============================================================================
+// webcam_internal.h - Shared state between the backend and optional modules
+// ============================================================================
+#ifndef WEBCAM_INTERNAL_H
+#define WEBCAM_INTERNAL_H
+
+#include "webcam.h"
+#include "webcam_atomic.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Persistent worker pool for row-parallel transforms (webcam_workers.c)
+typedef struct WebcamWorkers WebcamWorkers;
+typedef void (*WebcamRowFn)(void *ctx, int row_begin, int row_end);
+
+WebcamWorkers* webcam_workers_create(int threads);
+void webcam_workers_destroy(WebcamWorkers *workers);
+int webcam_workers_count(WebcamWorkers *workers);
+// Runs fn over [0, rows) in bands; returns when every band is done.
+// NULL workers runs everything on the calling thread.
+void webcam_parallel_rows(WebcamWorkers *workers, int rows, WebcamRowFn fn, void *ctx);
+// Every pool thread applies profile to itself, worker i on the i-th CPU of
+// the mask; returns once all have, -1 if any was refused
+int webcam_workers_set_rt(WebcamWorkers *workers, const WebcamRtProfile *profile);
+
+// Uncompressed frame whose size matches its format (webcam_convert.c)
+#define MAX_ROW_WIDTH 8192
+int webcam_frame_valid(const WebcamFrame *src);
+// Bilinear source coordinate (16.16) of destination pixel d, centers aligned
+int webcam_src_coord(int d, int src_len, int dst_len);
+
+// Horizontal bilinear pass over source row y (webcam_tensor.c): for each of n
+// columns, Y/U/V or R/G/B in 8.8 fixed point blended between x0 and x1 with
+// weight fx. Uncompressed non-Bayer formats only.
+void webcam_sample_row(const WebcamFrame *src, int y, const int *x0, const int *x1,
+                       const unsigned char *fx, int n, unsigned short *const out[3]);
+
+// Row kernels (webcam_kernels.c, SSE2 on x86) over planar int16 lines:
+// vertical blend of two sampled rows with 8-bit weight fy (b unread when 0),
+// in-place BT.601 YUV -> RGB, and saturating pack to RGB24/RGB32 (bpp 3 or 4).
+void webcam_blend_rows(unsigned short *const a[3], unsigned short *const b[3],
+                       int fy, int n, short *const out[3]);
+void webcam_yuv_to_rgb(short *const c[3], int n);
+void webcam_pack_rgb(short *const c[3], int n, unsigned char *out, int bpp);
+
+// Raw Bayer formats (webcam_bayer.c). webcam_bayer_row() writes w bilinear
+// RGB pixels of row y starting at x0, bpp 3 or 4.
+int webcam_is_bayer(WebcamPixelFormat format);
+void webcam_bayer_row(const WebcamFrame *src, int y, int x0, int w, unsigned char *out, int bpp);
+
+// Standard JPEG tables, ITU T.81 Annex K (webcam_jpeg.c)
+extern const unsigned char webcam_jpeg_zigzag[64];
+extern const unsigned char webcam_jpeg_dc_bits[2][16];
+extern const unsigned char webcam_jpeg_dc_vals[12];
+extern const unsigned char webcam_jpeg_ac_bits[2][16];
+extern const unsigned char webcam_jpeg_ac_vals[2][162];
+
+// Frame decimation (webcam_common.c): keeps every Nth frame and at most one
+// frame per interval, judged on capture timestamps
+typedef struct {
+    int every_nth;              // <= 1 keeps every frame
+    uint64_t interval_us;       // 0 = no rate limit
+    unsigned long count;
+    uint64_t next_us;           // Earliest timestamp of the next kept frame
+    uint64_t last_us;
+} WebcamDecimator;
+
+void webcam_decimator_set(WebcamDecimator *d, int every_nth, int max_fps);
+// 1 if the frame captured at ts_us should be dropped
+int webcam_decimator_skip(WebcamDecimator *d, uint64_t ts_us);
+
+// Real-time helpers (webcam_rt.c). slot < 0 pins the calling thread to the
+// whole mask, otherwise to the slot-th CPU in it (wrapping).
+int webcam_rt_apply_self(const WebcamRtProfile *profile, int slot);
+
+// Wakeup latency histogram, written by the capture thread only. Readers on
+// other threads copy it under a seqlock and retry if a write overlapped.
+#define WEBCAM_LATENCY_BUCKETS 128  // Quarter octaves up to 2^31 us
+
+typedef struct {
+    atomic_int32 seq;               // Odd while the writer updates the figures
+    unsigned long samples;
+    uint64_t min_us;
+    uint64_t max_us;
+    uint64_t sum_us;
+    unsigned long buckets[WEBCAM_LATENCY_BUCKETS];
+    int start_of_exposure;
+    atomic_int32 reset;             // Set by readers, honoured by the writer
+} WebcamLatency;
+
+void webcam_latency_record(WebcamLatency *l, uint64_t us, int start_of_exposure);
+void webcam_latency_read(WebcamLatency *l, WebcamLatencyStats *stats, int reset);
+
+// Lock-free control queue (webcam_control.c). Any thread pushes; whoever wins
+// the drain flag applies pending changes in order, so capture never waits on a
+// setter. Every applied change is a new generation (the push ticket + 1).
+#define WEBCAM_CONTROL_SLOTS   32   // Powers of two
+#define WEBCAM_CONTROL_HISTORY 16
+
+typedef struct {
+    struct {
+        atomic_int32 seq;           // Ticket + 1 when full, ticket + SLOTS when free
+        int param;
+        long value;
+        int set_auto;
+    } slots[WEBCAM_CONTROL_SLOTS];
+    atomic_int32 tail;              // Next push ticket
+    atomic_int32 head;              // Next ticket to apply
+    atomic_int32 applied;           // Newest applied generation
+    atomic_int32 draining;
+    atomic_int32 result[WEBCAM_CONTROL_SLOTS];   // Generation << 1 | rejected, by generation
+    int64_t applied_us[WEBCAM_CONTROL_HISTORY];  // Apply time, by generation
+} WebcamControls;
+
+void webcam_controls_init(WebcamControls *c);
+// Called by the capture path before dequeuing: one relaxed compare when idle,
+// and never waits for another thread's changes
+void webcam_controls_apply(Webcam *cam);
+// Newest generation applied at or before ts_us (webcam_now_us() clock)
+uint32_t webcam_controls_at(WebcamControls *c, uint64_t ts_us);
+
+// Implemented by each backend
+WebcamWorkers* webcam_get_workers(Webcam *cam);
+WebcamControls* webcam_get_controls(Webcam *cam);
+// Writes one control to the driver: the value, or the auto flag if set_auto
+int webcam_apply_control(Webcam *cam, WebcamParameter param, long value, int set_auto);
+// Clock of WebcamFrame.timestamp_us
+uint64_t webcam_now_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __linux__
+
+#define MAX_BUFFERS 4
+
+struct Webcam {
+    int fd;
+    int actual_width;
+    int actual_height;
+    struct {
+        void *start;
+        size_t length;
+        int refs;           // 0 = queued in the driver, >0 = held by user/modules
+    } buffers[MAX_BUFFERS];
+    int buffer_count;
+    int current_buffer_index;
+    WebcamPixelFormat format;
+    WebcamWorkers *workers;
+    WebcamDecimator decimator;
+    WebcamControls controls;
+    WebcamRtProfile rt;         // Applied to worker threads, also future ones
+    WebcamLatency latency;
+};
+
+// Buffer ownership: a dequeued buffer goes back to the driver only when the
+// last holder drops it. webcam_capture() hands out the first reference.
+int webcam_buffer_find(Webcam *cam, const unsigned char *data);
+void webcam_buffer_ref(Webcam *cam, int index);
+void webcam_buffer_unref(Webcam *cam, int index);
+
+#endif // __linux__
+
+#endif // WEBCAM_INTERNAL_H
@@ -0,0 +1,786 @@
+// ============================================================================
+// webcam_jpeg.c - Baseline JPEG encoder reading native camera formats
+// ============================================================================
+// YUYV is coded as 4:2:2, YUV420/NV12 as 4:2:0 and GRAY8 as a single
+// component straight from the capture buffer, so no RGB round-trip happens
+// (RGB input is converted per MCU).
+// Every MCU row is a restart interval: rows are entropy-coded independently
+// on the camera's worker pool into per-row buffers owned by the encoder, then
+// joined with RSTn markers. The forward DCT is the AAN float DCT, run on four
+// columns at a time (SSE2 on x86), with the AAN scale factors folded into the
+// quantizer reciprocals.
+// ============================================================================
+#include "webcam_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define JPEG_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+#define MCU_MAX_BYTES 4096      // 6 blocks, worst case with 0xFF stuffing
+
+typedef struct { unsigned short code; unsigned char size; } HuffCode;
+
+typedef struct {
+    unsigned char *data;
+    size_t cap, len;
+    int failed;
+} JpegSegment;
+
+struct WebcamJpegEncoder {
+    Webcam *cam;
+    int quality;
+    unsigned char qtable[2][64];        // Zigzag order, as written to DQT
+    float recip[2][64];                 // Transposed natural order, AAN-scaled
+    HuffCode dc[2][12];
+    HuffCode ac[2][256];
+    JpegSegment *segs;
+    int seg_count;
+};
+
+// ---------------------------------------------------------------------------
+// Tables (ITU T.81 Annex K)
+// ---------------------------------------------------------------------------
+
+const unsigned char webcam_jpeg_zigzag[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+
+static const unsigned char base_qtable[2][64] = {
+    { 16, 11, 10, 16,  24,  40,  51,  61,
+      12, 12, 14, 19,  26,  58,  60,  55,
+      14, 13, 16, 24,  40,  57,  69,  56,
+      14, 17, 22, 29,  51,  87,  80,  62,
+      18, 22, 37, 56,  68, 109, 103,  77,
+      24, 35, 55, 64,  81, 104, 113,  92,
+      49, 64, 78, 87, 103, 121, 120, 101,
+      72, 92, 95, 98, 112, 100, 103,  99 },
+    { 17, 18, 24, 47, 99, 99, 99, 99,
+      18, 21, 26, 66, 99, 99, 99, 99,
+      24, 26, 56, 99, 99, 99, 99, 99,
+      47, 66, 99, 99, 99, 99, 99, 99,
+      99, 99, 99, 99, 99, 99, 99, 99,
+      99, 99, 99, 99, 99, 99, 99, 99,
+      99, 99, 99, 99, 99, 99, 99, 99,
+      99, 99, 99, 99, 99, 99, 99, 99 }
+};
+
+const unsigned char webcam_jpeg_dc_bits[2][16] = {
+    { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 },
+    { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 }
+};
+
+const unsigned char webcam_jpeg_dc_vals[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+const unsigned char webcam_jpeg_ac_bits[2][16] = {
+    { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d },
+    { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 }
+};
+
+const unsigned char webcam_jpeg_ac_vals[2][162] = {
+    { 0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+      0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+      0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+      0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+      0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+      0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+      0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+      0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+      0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+      0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+      0xf9, 0xfa },
+    { 0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+      0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+      0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+      0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+      0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+      0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+      0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+      0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+      0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+      0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+      0xf9, 0xfa }
+};
+
+// AAN output scale: cos(k * pi / 16) * sqrt(2), 1 for k = 0
+static const float aan_scale[8] = {
+    1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+    1.0f, 0.785694958f, 0.541196100f, 0.275899379f
+};
+
+static void build_huffman(const unsigned char bits[16], const unsigned char *vals, HuffCode *out) {
+    int code = 0, k = 0;
+    for (int len = 1; len <= 16; len++) {
+        for (int i = 0; i < bits[len - 1]; i++, k++) {
+            out[vals[k]].code = (unsigned short)code++;
+            out[vals[k]].size = (unsigned char)len;
+        }
+        code <<= 1;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Forward DCT + quantization on 4-column vectors
+// ---------------------------------------------------------------------------
+
+#ifdef JPEG_SSE2
+typedef __m128 vf;
+#define vf_add(a, b)  _mm_add_ps((a), (b))
+#define vf_sub(a, b)  _mm_sub_ps((a), (b))
+#define vf_mul(a, k)  _mm_mul_ps((a), _mm_set1_ps(k))
+#else
+typedef struct { float v[4]; } vf;
+static vf vf_add(vf a, vf b) { for (int i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+static vf vf_sub(vf a, vf b) { for (int i = 0; i < 4; i++) a.v[i] -= b.v[i]; return a; }
+static vf vf_mul(vf a, float k) { for (int i = 0; i < 4; i++) a.v[i] *= k; return a; }
+#endif
+
+// One AAN pass over 8 vectors (jfdctflt.c), four independent lines at once
+static void fdct_1d(vf d[8]) {
+    vf t0 = vf_add(d[0], d[7]), t7 = vf_sub(d[0], d[7]);
+    vf t1 = vf_add(d[1], d[6]), t6 = vf_sub(d[1], d[6]);
+    vf t2 = vf_add(d[2], d[5]), t5 = vf_sub(d[2], d[5]);
+    vf t3 = vf_add(d[3], d[4]), t4 = vf_sub(d[3], d[4]);
+
+    vf t10 = vf_add(t0, t3), t13 = vf_sub(t0, t3);
+    vf t11 = vf_add(t1, t2), t12 = vf_sub(t1, t2);
+    d[0] = vf_add(t10, t11);
+    d[4] = vf_sub(t10, t11);
+    vf z1 = vf_mul(vf_add(t12, t13), 0.707106781f);
+    d[2] = vf_add(t13, z1);
+    d[6] = vf_sub(t13, z1);
+
+    t10 = vf_add(t4, t5);
+    t11 = vf_add(t5, t6);
+    t12 = vf_add(t6, t7);
+    vf z5 = vf_mul(vf_sub(t10, t12), 0.382683433f);
+    vf z2 = vf_add(vf_mul(t10, 0.541196100f), z5);
+    vf z4 = vf_add(vf_mul(t12, 1.306562965f), z5);
+    vf z3 = vf_mul(t11, 0.707106781f);
+    vf z11 = vf_add(t7, z3), z13 = vf_sub(t7, z3);
+    d[5] = vf_add(z13, z2);
+    d[3] = vf_sub(z13, z2);
+    d[1] = vf_add(z11, z4);
+    d[7] = vf_sub(z11, z4);
+}
+
+// b[row][half] holds columns 4*half .. 4*half+3 of a row
+static void load_block(const unsigned char *s, int stride, vf b[8][2]) {
+    for (int r = 0; r < 8; r++, s += stride) {
+#ifdef JPEG_SSE2
+        __m128i px = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)s), _mm_setzero_si128());
+        __m128i bias = _mm_set1_epi16(128);
+        px = _mm_sub_epi16(px, bias);
+        b[r][0] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(px, px), 16));
+        b[r][1] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(px, px), 16));
+#else
+        for (int c = 0; c < 8; c++) b[r][c >> 2].v[c & 3] = (float)(s[c] - 128);
+#endif
+    }
+}
+
+static void transpose_4x4(vf *a, vf *b, vf *c, vf *d) {
+#ifdef JPEG_SSE2
+    _MM_TRANSPOSE4_PS(*a, *b, *c, *d);
+#else
+    vf *m[4] = { a, b, c, d };
+    for (int i = 0; i < 4; i++)
+        for (int j = i + 1; j < 4; j++) {
+            float t = m[i]->v[j];
+            m[i]->v[j] = m[j]->v[i];
+            m[j]->v[i] = t;
+        }
+#endif
+}
+
+static void transpose_block(vf b[8][2]) {
+    transpose_4x4(&b[0][0], &b[1][0], &b[2][0], &b[3][0]);
+    transpose_4x4(&b[4][1], &b[5][1], &b[6][1], &b[7][1]);
+    transpose_4x4(&b[0][1], &b[1][1], &b[2][1], &b[3][1]);
+    transpose_4x4(&b[4][0], &b[5][0], &b[6][0], &b[7][0]);
+    for (int r = 0; r < 4; r++) {
+        vf t = b[r][1];
+        b[r][1] = b[r + 4][0];
+        b[r + 4][0] = t;
+    }
+}
+
+// DCT + quantize an 8x8 block; out is transposed (out[v * 8 + u])
+static void fdct_quant(const unsigned char *s, int stride, const float *recip, short out[64]) {
+    vf b[8][2], d[8];
+    load_block(s, stride, b);
+    // Vertical pass, transpose, horizontal pass: leaves b[v][u]
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass) transpose_block(b);
+        for (int h = 0; h < 2; h++) {
+            for (int r = 0; r < 8; r++) d[r] = b[r][h];
+            fdct_1d(d);
+            for (int r = 0; r < 8; r++) b[r][h] = d[r];
+        }
+    }
+
+    for (int r = 0; r < 8; r++) {
+#ifdef JPEG_SSE2
+        __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(b[r][0], _mm_loadu_ps(recip + r * 8)));
+        __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(b[r][1], _mm_loadu_ps(recip + r * 8 + 4)));
+        _mm_storeu_si128((__m128i*)(out + r * 8), _mm_packs_epi32(lo, hi));
+#else
+        for (int c = 0; c < 8; c++) {
+            float v = b[r][c >> 2].v[c & 3] * recip[r * 8 + c];
+            out[r * 8 + c] = (short)(v >= 0 ? v + 0.5f : v - 0.5f);
+        }
+#endif
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Entropy coding
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    unsigned char *p;
+    uint64_t acc;
+    int bits;
+} BitWriter;
+
+static int bit_length(unsigned v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return v ? 32 - __builtin_clz(v) : 0;
+#elif defined(_MSC_VER)
+    unsigned long i;
+    return _BitScanReverse(&i, v) ? (int)i + 1 : 0;
+#else
+    int n = 0;
+    while (v) { n++; v >>= 1; }
+    return n;
+#endif
+}
+
+static void emit_byte(BitWriter *w, unsigned char b) {
+    *w->p++ = b;
+    if (b == 0xFF) *w->p++ = 0;
+}
+
+// size <= 27, so the accumulator never holds more than 58 bits
+static void put_bits(BitWriter *w, uint32_t value, int size) {
+    w->acc = (w->acc << size) | value;
+    w->bits += size;
+    if (w->bits < 32) return;
+
+    w->bits -= 32;
+    uint32_t v = (uint32_t)(w->acc >> w->bits);
+    uint32_t inv = ~v;
+    if (((inv - 0x01010101u) & ~inv & 0x80808080u) == 0) {
+        // No 0xFF byte, no stuffing needed
+        w->p[0] = (unsigned char)(v >> 24);
+        w->p[1] = (unsigned char)(v >> 16);
+        w->p[2] = (unsigned char)(v >> 8);
+        w->p[3] = (unsigned char)v;
+        w->p += 4;
+    } else {
+        emit_byte(w, (unsigned char)(v >> 24));
+        emit_byte(w, (unsigned char)(v >> 16));
+        emit_byte(w, (unsigned char)(v >> 8));
+        emit_byte(w, (unsigned char)v);
+    }
+}
+
+// Pad the last byte with 1 bits
+static void flush_bits(BitWriter *w) {
+    int pad = (8 - (w->bits & 7)) & 7;
+    put_bits(w, (1u << pad) - 1, pad);
+    while (w->bits >= 8) {
+        w->bits -= 8;
+        emit_byte(w, (unsigned char)(w->acc >> w->bits));
+    }
+}
+
+static void put_symbol(BitWriter *w, HuffCode h, int value, int nbits) {
+    // Negative values are sent as value - 1 in nbits bits
+    uint32_t extra = (uint32_t)(value < 0 ? value - 1 : value) & ((1u << nbits) - 1);
+    put_bits(w, ((uint32_t)h.code << nbits) | extra, h.size + nbits);
+}
+
+static void encode_block(BitWriter *w, const short *coef, int *last_dc,
+                         const HuffCode *dc, const HuffCode *ac) {
+    int diff = coef[0] - *last_dc;
+    *last_dc = coef[0];
+    int n = bit_length((unsigned)(diff < 0 ? -diff : diff));
+    if (n > 11) n = 11;
+    put_symbol(w, dc[n], diff, n);
+
+    int run = 0;
+    for (int k = 1; k < 64; k++) {
+        // coef is transposed: natural index u * 8 + v lives at v * 8 + u
+        int nat = webcam_jpeg_zigzag[k];
+        int v = coef[(nat & 7) * 8 + (nat >> 3)];
+        if (v == 0) {
+            run++;
+            continue;
+        }
+        while (run >= 16) {
+            put_bits(w, ac[0xF0].code, ac[0xF0].size);
+            run -= 16;
+        }
+        if (v > 1023) v = 1023;
+        if (v < -1023) v = -1023;
+        n = bit_length((unsigned)(v < 0 ? -v : v));
+        put_symbol(w, ac[(run << 4) | n], v, n);
+        run = 0;
+    }
+    if (run) put_bits(w, ac[0x00].code, ac[0x00].size);
+}
+
+// ---------------------------------------------------------------------------
+// MCU assembly
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    WebcamJpegEncoder *enc;
+    const WebcamFrame *src;
+    int gray;                   // Single component, 8x8 MCUs
+    int mcu_w, mcu_h;           // 16x16 (4:2:0), 16x8 (4:2:2) or 8x8 (gray)
+    int mcus_x;
+} JpegJob;
+
+typedef struct {
+    const unsigned char *y, *cb, *cr;
+    int y_stride, c_stride;
+    unsigned char ybuf[16 * 16], cbbuf[64], crbuf[64];
+} Mcu;
+
+static int clampi(int v, int lo, int hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+static void rgb_to_ycc(const unsigned char *p, int *y, int *cb, int *cr) {
+    int r = p[0], g = p[1], b = p[2];
+    *y = (19595 * r + 38470 * g + 7471 * b + 32768) >> 16;
+    *cb = (-11059 * r - 21709 * g + 32768 * b + (128 << 16) + 32768) >> 16;
+    *cr = (32768 * r - 27439 * g - 5329 * b + (128 << 16) + 32768) >> 16;
+}
+
+// Slow path with edge replication for MCUs that cross the frame border
+static void gather_mcu(const JpegJob *job, int mx, int my, Mcu *m) {
+    const WebcamFrame *f = job->src;
+    const int W = f->width, H = f->height, x0 = mx * 16, y0 = my * job->mcu_h;
+    const int rgb = f->format == WEBCAM_FMT_RGB24 || f->format == WEBCAM_FMT_RGB32;
+    // RGB chroma covers odd edges; camera chroma planes are truncated
+    const int cw = rgb ? (W + 1) >> 1 : W >> 1;
+    const int ch = job->mcu_h == 8 ? H : (rgb ? (H + 1) >> 1 : H >> 1);
+    const unsigned char *d = f->data;
+    const int bpp = f->format == WEBCAM_FMT_RGB32 ? 4 : 3;
+    int Y, Cb, Cr;
+
+    for (int j = 0; j < job->mcu_h; j++) {
+        int y = clampi(y0 + j, 0, H - 1);
+        for (int i = 0; i < 16; i++) {
+            int x = clampi(x0 + i, 0, W - 1);
+            unsigned char *o = &m->ybuf[j * 16 + i];
+            switch (f->format) {
+                case WEBCAM_FMT_YUYV: *o = d[((size_t)y * W + x) * 2]; break;
+                case WEBCAM_FMT_RGB24:
+                case WEBCAM_FMT_RGB32:
+                    rgb_to_ycc(d + ((size_t)y * W + x) * bpp, &Y, &Cb, &Cr);
+                    *o = (unsigned char)Y;
+                    break;
+                default: *o = d[(size_t)y * W + x]; break;
+            }
+        }
+    }
+
+    for (int j = 0; j < 8; j++) {
+        int cy = clampi((job->mcu_h == 16 ? y0 / 2 : y0) + j, 0, ch - 1);
+        for (int i = 0; i < 8; i++) {
+            int cx = clampi(x0 / 2 + i, 0, cw - 1);
+            unsigned char *ocb = &m->cbbuf[j * 8 + i], *ocr = &m->crbuf[j * 8 + i];
+            switch (f->format) {
+                case WEBCAM_FMT_YUYV: {
+                    const unsigned char *p = d + (size_t)cy * W * 2 + (size_t)cx * 4;
+                    *ocb = p[1];
+                    *ocr = p[3];
+                    break;
+                }
+                case WEBCAM_FMT_YUV420: {
+                    const unsigned char *pu = d + (size_t)W * H;
+                    *ocb = pu[(size_t)cy * cw + cx];
+                    *ocr = pu[(size_t)cw * ch + (size_t)cy * cw + cx];
+                    break;
+                }
+                case WEBCAM_FMT_NV12: {
+                    const unsigned char *p = d + (size_t)W * H + (size_t)cy * W + (size_t)cx * 2;
+                    *ocb = p[0];
+                    *ocr = p[1];
+                    break;
+                }
+                default: {
+                    // Average the 2x2 RGB pixels behind this chroma sample
+                    int sb = 0, sr = 0;
+                    for (int k = 0; k < 4; k++) {
+                        int x = clampi(cx * 2 + (k & 1), 0, W - 1);
+                        int y = clampi(cy * 2 + (k >> 1), 0, H - 1);
+                        rgb_to_ycc(d + ((size_t)y * W + x) * bpp, &Y, &Cb, &Cr);
+                        sb += Cb;
+                        sr += Cr;
+                    }
+                    *ocb = (unsigned char)((sb + 2) >> 2);
+                    *ocr = (unsigned char)((sr + 2) >> 2);
+                    break;
+                }
+            }
+        }
+    }
+
+    m->y = m->ybuf;
+    m->cb = m->cbbuf;
+    m->cr = m->crbuf;
+    m->y_stride = 16;
+    m->c_stride = 8;
+}
+
+static void load_gray_mcu(const JpegJob *job, int mx, int my, Mcu *m) {
+    const WebcamFrame *f = job->src;
+    const int W = f->width, H = f->height, x0 = mx * 8, y0 = my * 8;
+
+    if (x0 + 8 <= W && y0 + 8 <= H) {
+        m->y = f->data + (size_t)y0 * W + x0;
+        m->y_stride = W;
+        return;
+    }
+    for (int j = 0; j < 8; j++) {
+        const unsigned char *s = f->data + (size_t)clampi(y0 + j, 0, H - 1) * W;
+        for (int i = 0; i < 8; i++) m->ybuf[j * 8 + i] = s[clampi(x0 + i, 0, W - 1)];
+    }
+    m->y = m->ybuf;
+    m->y_stride = 8;
+}
+
+static void load_mcu(const JpegJob *job, int mx, int my, Mcu *m) {
+    const WebcamFrame *f = job->src;
+    const int W = f->width, H = f->height, x0 = mx * 16, y0 = my * job->mcu_h;
+    const int interior = x0 + 16 <= W && y0 + job->mcu_h <= H &&
+                         ((W | H) & 1) == 0;
+
+    if (!interior) {
+        gather_mcu(job, mx, my, m);
+        return;
+    }
+
+    switch (f->format) {
+        case WEBCAM_FMT_YUV420: {
+            // Blocks are read in place
+            const size_t luma = (size_t)W * H;
+            m->y = f->data + (size_t)y0 * W + x0;
+            m->cb = f->data + luma + (size_t)(y0 / 2) * (W / 2) + x0 / 2;
+            m->cr = m->cb + luma / 4;
+            m->y_stride = W;
+            m->c_stride = W / 2;
+            return;
+        }
+        case WEBCAM_FMT_NV12: {
+            const unsigned char *uv = f->data + (size_t)W * H + (size_t)(y0 / 2) * W + x0;
+            for (int j = 0; j < 8; j++, uv += W)
+                for (int i = 0; i < 8; i++) {
+                    m->cbbuf[j * 8 + i] = uv[i * 2];
+                    m->crbuf[j * 8 + i] = uv[i * 2 + 1];
+                }
+            m->y = f->data + (size_t)y0 * W + x0;
+            m->y_stride = W;
+            m->cb = m->cbbuf;
+            m->cr = m->crbuf;
+            m->c_stride = 8;
+            return;
+        }
+        case WEBCAM_FMT_YUYV: {
+            const unsigned char *s = f->data + ((size_t)y0 * W + x0) * 2;
+            for (int j = 0; j < 8; j++, s += (size_t)W * 2) {
+                const unsigned char *p = s;
+                for (int i = 0; i < 8; i++, p += 4) {
+                    m->ybuf[j * 16 + i * 2] = p[0];
+                    m->ybuf[j * 16 + i * 2 + 1] = p[2];
+                    m->cbbuf[j * 8 + i] = p[1];
+                    m->crbuf[j * 8 + i] = p[3];
+                }
+            }
+            m->y = m->ybuf;
+            m->cb = m->cbbuf;
+            m->cr = m->crbuf;
+            m->y_stride = 16;
+            m->c_stride = 8;
+            return;
+        }
+        case WEBCAM_FMT_RGB24:
+        case WEBCAM_FMT_RGB32: {
+            const int bpp = f->format == WEBCAM_FMT_RGB32 ? 4 : 3;
+            const size_t stride = (size_t)W * bpp;
+            const unsigned char *s = f->data + (size_t)y0 * stride + (size_t)x0 * bpp;
+            for (int j = 0; j < 8; j++, s += 2 * stride) {
+                for (int i = 0; i < 8; i++) {
+                    int Y, Cb, Cr, sb = 0, sr = 0;
+                    for (int k = 0; k < 4; k++) {
+                        rgb_to_ycc(s + (k >> 1) * stride + (i * 2 + (k & 1)) * bpp, &Y, &Cb, &Cr);
+                        m->ybuf[(j * 2 + (k >> 1)) * 16 + i * 2 + (k & 1)] = (unsigned char)Y;
+                        sb += Cb;
+                        sr += Cr;
+                    }
+                    m->cbbuf[j * 8 + i] = (unsigned char)((sb + 2) >> 2);
+                    m->crbuf[j * 8 + i] = (unsigned char)((sr + 2) >> 2);
+                }
+            }
+            m->y = m->ybuf;
+            m->cb = m->cbbuf;
+            m->cr = m->crbuf;
+            m->y_stride = 16;
+            m->c_stride = 8;
+            return;
+        }
+        default:
+            return;
+    }
+}
+
+static int segment_reserve(JpegSegment *seg, BitWriter *w) {
+    size_t used = (size_t)(w->p - seg->data);
+    if (seg->cap - used >= MCU_MAX_BYTES) return 0;
+
+    size_t cap = seg->cap * 2 > used + MCU_MAX_BYTES ? seg->cap * 2 : used + MCU_MAX_BYTES;
+    unsigned char *p = (unsigned char*)realloc(seg->data, cap);
+    if (!p) return -1;
+    seg->data = p;
+    seg->cap = cap;
+    w->p = p + used;
+    return 0;
+}
+
+static void encode_rows(void *ctx, int begin, int end) {
+    const JpegJob *job = (const JpegJob*)ctx;
+    WebcamJpegEncoder *enc = job->enc;
+    const int luma_blocks = job->mcu_h / 8 * 2;
+    short coef[64];
+    Mcu m;
+
+    for (int my = begin; my < end; my++) {
+        JpegSegment *seg = &enc->segs[my];
+        BitWriter w = { seg->data, 0, 0 };
+        int dc[3] = { 0, 0, 0 };
+        seg->failed = 0;
+
+        for (int mx = 0; mx < job->mcus_x; mx++) {
+            if (segment_reserve(seg, &w) != 0) {
+                seg->failed = 1;
+                break;
+            }
+            if (job->gray) {
+                load_gray_mcu(job, mx, my, &m);
+                fdct_quant(m.y, m.y_stride, enc->recip[0], coef);
+                encode_block(&w, coef, &dc[0], enc->dc[0], enc->ac[0]);
+                continue;
+            }
+            load_mcu(job, mx, my, &m);
+            for (int b = 0; b < luma_blocks; b++) {
+                fdct_quant(m.y + (b >> 1) * 8 * m.y_stride + (b & 1) * 8, m.y_stride,
+                           enc->recip[0], coef);
+                encode_block(&w, coef, &dc[0], enc->dc[0], enc->ac[0]);
+            }
+            fdct_quant(m.cb, m.c_stride, enc->recip[1], coef);
+            encode_block(&w, coef, &dc[1], enc->dc[1], enc->ac[1]);
+            fdct_quant(m.cr, m.c_stride, enc->recip[1], coef);
+            encode_block(&w, coef, &dc[2], enc->dc[1], enc->ac[1]);
+        }
+        if (!seg->failed) flush_bits(&w);
+        seg->len = seg->failed ? 0 : (size_t)(w.p - seg->data);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Headers
+// ---------------------------------------------------------------------------
+
+static unsigned char* put_u16(unsigned char *p, int v) {
+    p[0] = (unsigned char)(v >> 8);
+    p[1] = (unsigned char)v;
+    return p + 2;
+}
+
+static unsigned char* put_dht(unsigned char *p, int cls_id, const unsigned char bits[16],
+                              const unsigned char *vals) {
+    int n = 0;
+    *p++ = (unsigned char)cls_id;
+    for (int i = 0; i < 16; i++) {
+        *p++ = bits[i];
+        n += bits[i];
+    }
+    memcpy(p, vals, n);
+    return p + n;
+}
+
+#define JPEG_HEADER_MAX 700
+
+static size_t write_headers(const WebcamJpegEncoder *enc, const JpegJob *job, unsigned char *dst) {
+    static const unsigned char jfif[] = {
+        0xFF, 0xD8,                                             // SOI
+        0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00,       // APP0
+        0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00
+    };
+    unsigned char *p = dst;
+    memcpy(p, jfif, sizeof(jfif));
+    p += sizeof(jfif);
+
+    // DQT
+    *p++ = 0xFF; *p++ = 0xDB;
+    p = put_u16(p, 2 + 2 * 65);
+    for (int t = 0; t < 2; t++) {
+        *p++ = (unsigned char)t;
+        memcpy(p, enc->qtable[t], 64);
+        p += 64;
+    }
+
+    // SOF0
+    *p++ = 0xFF; *p++ = 0xC0;
+    p = put_u16(p, job->gray ? 11 : 17);
+    *p++ = 8;
+    p = put_u16(p, job->src->height);
+    p = put_u16(p, job->src->width);
+    if (job->gray) {
+        *p++ = 1;
+        *p++ = 1; *p++ = 0x11; *p++ = 0;
+    } else {
+        *p++ = 3;
+        *p++ = 1; *p++ = job->mcu_h == 16 ? 0x22 : 0x21; *p++ = 0;
+        *p++ = 2; *p++ = 0x11; *p++ = 1;
+        *p++ = 3; *p++ = 0x11; *p++ = 1;
+    }
+
+    // DHT
+    *p++ = 0xFF; *p++ = 0xC4;
+    p = put_u16(p, 2 + 2 * (17 + 12) + 2 * (17 + 162));
+    p = put_dht(p, 0x00, webcam_jpeg_dc_bits[0], webcam_jpeg_dc_vals);
+    p = put_dht(p, 0x10, webcam_jpeg_ac_bits[0], webcam_jpeg_ac_vals[0]);
+    p = put_dht(p, 0x01, webcam_jpeg_dc_bits[1], webcam_jpeg_dc_vals);
+    p = put_dht(p, 0x11, webcam_jpeg_ac_bits[1], webcam_jpeg_ac_vals[1]);
+
+    // DRI: one restart interval per MCU row
+    *p++ = 0xFF; *p++ = 0xDD;
+    p = put_u16(p, 4);
+    p = put_u16(p, job->mcus_x);
+
+    // SOS
+    static const unsigned char sos[] = {
+        0xFF, 0xDA, 0x00, 0x0C, 0x03, 0x01, 0x00, 0x02, 0x11, 0x03, 0x11, 0x00, 0x3F, 0x00
+    };
+    static const unsigned char sos_gray[] = {
+        0xFF, 0xDA, 0x00, 0x08, 0x01, 0x01, 0x00, 0x00, 0x3F, 0x00
+    };
+    if (job->gray) {
+        memcpy(p, sos_gray, sizeof(sos_gray));
+        p += sizeof(sos_gray);
+    } else {
+        memcpy(p, sos, sizeof(sos));
+        p += sizeof(sos);
+    }
+    return (size_t)(p - dst);
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+WEBCAM_API WebcamJpegEncoder* webcam_jpeg_create(Webcam *cam, int quality) {
+    WebcamJpegEncoder *enc = (WebcamJpegEncoder*)calloc(1, sizeof(WebcamJpegEncoder));
+    if (!enc) return NULL;
+    enc->cam = cam;
+    for (int t = 0; t < 2; t++) {
+        build_huffman(webcam_jpeg_dc_bits[t], webcam_jpeg_dc_vals, enc->dc[t]);
+        build_huffman(webcam_jpeg_ac_bits[t], webcam_jpeg_ac_vals[t], enc->ac[t]);
+    }
+    webcam_jpeg_set_quality(enc, quality);
+    return enc;
+}
+
+WEBCAM_API int webcam_jpeg_set_quality(WebcamJpegEncoder *enc, int quality) {
+    if (!enc) return -1;
+    if (quality < 1) quality = 1;
+    if (quality > 100) quality = 100;
+    enc->quality = quality;
+
+    // libjpeg's quality scaling of the Annex K tables
+    int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    for (int t = 0; t < 2; t++) {
+        for (int k = 0; k < 64; k++) {
+            int nat = webcam_jpeg_zigzag[k];
+            int q = (base_qtable[t][nat] * scale + 50) / 100;
+            q = clampi(q, 1, 255);
+            enc->qtable[t][k] = (unsigned char)q;
+            int u = nat >> 3, v = nat & 7;
+            enc->recip[t][v * 8 + u] = 1.0f / (q * aan_scale[u] * aan_scale[v] * 8.0f);
+        }
+    }
+    return 0;
+}
+
+WEBCAM_API int webcam_jpeg_encode(WebcamJpegEncoder *enc, const WebcamFrame *src,
+                                  unsigned char *dst, size_t dst_size, size_t *out_size) {
+    if (!enc || !webcam_frame_valid(src) || (!dst && dst_size)) return -1;
+    if (src->height > 65535 || webcam_is_bayer(src->format)) return -1;
+
+    JpegJob job;
+    job.enc = enc;
+    job.src = src;
+    job.gray = src->format == WEBCAM_FMT_GRAY8;
+    job.mcu_w = job.gray ? 8 : 16;
+    job.mcu_h = job.gray || src->format == WEBCAM_FMT_YUYV ? 8 : 16;
+    // Subsampled camera formats need at least one chroma sample
+    if (src->format != WEBCAM_FMT_RGB24 && src->format != WEBCAM_FMT_RGB32 && !job.gray &&
+        (src->width < 2 || (job.mcu_h == 16 && src->height < 2))) return -1;
+    job.mcus_x = (src->width + job.mcu_w - 1) / job.mcu_w;
+    int mcus_y = (src->height + job.mcu_h - 1) / job.mcu_h;
+
+    if (mcus_y > enc->seg_count) {
+        JpegSegment *segs = (JpegSegment*)realloc(enc->segs, mcus_y * sizeof(JpegSegment));
+        if (!segs) return -1;
+        memset(segs + enc->seg_count, 0, (mcus_y - enc->seg_count) * sizeof(JpegSegment));
+        enc->segs = segs;
+        enc->seg_count = mcus_y;
+    }
+
+    webcam_parallel_rows(webcam_get_workers(enc->cam), mcus_y, encode_rows, &job);
+
+    // Header, segments separated by RSTn, EOI
+    size_t total = JPEG_HEADER_MAX + 2;
+    for (int i = 0; i < mcus_y; i++) {
+        if (enc->segs[i].failed) return -1;
+        total += enc->segs[i].len + 2;
+    }
+    if (total > dst_size) {
+        if (out_size) *out_size = total;
+        return -1;
+    }
+
+    unsigned char *p = dst + write_headers(enc, &job, dst);
+    for (int i = 0; i < mcus_y; i++) {
+        memcpy(p, enc->segs[i].data, enc->segs[i].len);
+        p += enc->segs[i].len;
+        if (i + 1 < mcus_y) {
+            *p++ = 0xFF;
+            *p++ = (unsigned char)(0xD0 + (i & 7));
+        }
+    }
+    *p++ = 0xFF;
+    *p++ = 0xD9;
+    if (out_size) *out_size = (size_t)(p - dst);
+    return 0;
+}
+
+WEBCAM_API void webcam_jpeg_destroy(WebcamJpegEncoder *enc) {
+    if (!enc) return;
+    for (int i = 0; i < enc->seg_count; i++) free(enc->segs[i].data);
+    free(enc->segs);
+    free(enc);
+}
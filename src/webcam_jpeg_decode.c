@@ -0,0 +1,626 @@
+// ============================================================================
+// webcam_jpeg_decode.c - Scaled baseline JPEG decoder for MJPEG previews
+// ============================================================================
+// Decodes straight to GRAY8 or YUV420 at 1/1, 1/2, 1/4 or 1/8 of the coded
+// size. The scale is applied inside the IDCT: 1/8 keeps only the DC term of
+// each block, 1/4 and 1/2 run a 2x2 / 4x4 IDCT on the low-frequency corner,
+// so the cost of everything after entropy decoding shrinks with the output.
+// Chroma is entropy-decoded but never transformed when GRAY8 is requested.
+// Baseline (SOF0/SOF1, 8-bit) only; the Annex K Huffman tables are used when
+// the stream has no DHT, as most UVC cameras send.
+// ============================================================================
+#include "webcam_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FAST_BITS 9
+#define MAX_COMPONENTS 3
+
+typedef struct {
+    unsigned short fast[1 << FAST_BITS];   // (length << 8) | symbol, 0 = longer code
+    int fast_ac[1 << FAST_BITS];           // (value << 8) | (run << 4) | total length
+    int maxcode[17];                       // Largest code of each length, -1 if none
+    int valoff[17];                        // vals index minus first code of each length
+    unsigned char vals[256];
+    int present;
+} HuffTable;
+
+typedef struct {
+    int id;
+    int h, v;                   // Sampling factors
+    int tq;                     // Quantization table
+    int td, ta;                 // Huffman tables of the current scan
+    int pred;                   // DC predictor
+    int needed;                 // Transformed into a plane (else only skipped)
+    int decoded;
+    unsigned char *plane;
+    int stride, rows;
+} JpegComponent;
+
+typedef struct {
+    const unsigned char *p, *end;
+    uint64_t acc;               // MSB-aligned
+    int bits;
+    int marker;                 // Hit a marker: feed zeros from here on
+} BitReader;
+
+struct WebcamJpegDecoder {
+    unsigned short qt[4][64];           // Natural order
+    float qmul[4][64];                  // qt * AAN factors / 8, for the full IDCT
+    HuffTable dc[4], ac[4];
+    HuffTable std_dc[2], std_ac[2];
+
+    int width, height;
+    int hmax, vmax;
+    int ncomp;
+    int restart_interval;
+    int scale, n;                       // Output block size n = 8 / scale
+    JpegComponent comp[MAX_COMPONENTS];
+    unsigned char *buf[MAX_COMPONENTS];
+    size_t buf_cap[MAX_COMPONENTS];
+};
+
+static const float aan_scale[8] = {
+    1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+    1.0f, 0.785694958f, 0.541196100f, 0.275899379f
+};
+
+// Bases of the n-point IDCT, [x][u] = C(u) cos((2x + 1) u pi / 2n) / 2, which
+// keeps the DC gain of the 8-point transform
+static const float idct2_basis[2 * 2] = {
+    0.353553391f,  0.353553391f,
+    0.353553391f, -0.353553391f
+};
+
+static const float idct4_basis[4 * 4] = {
+    0.353553391f,  0.461939766f,  0.353553391f,  0.191341716f,
+    0.353553391f,  0.191341716f, -0.353553391f, -0.461939766f,
+    0.353553391f, -0.191341716f, -0.353553391f,  0.461939766f,
+    0.353553391f, -0.461939766f,  0.353553391f, -0.191341716f
+};
+
+static unsigned char clamp_u8(int v) { return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v)); }
+
+// Level shift and round; anything below zero clamps anyway
+static unsigned char to_pixel(float v) { return clamp_u8((int)(v + 128.5f)); }
+
+// ---------------------------------------------------------------------------
+// Huffman decoding
+// ---------------------------------------------------------------------------
+
+static int build_table(HuffTable *t, const unsigned char bits[16], const unsigned char *vals) {
+    int code = 0, k = 0;
+    memset(t->fast, 0, sizeof(t->fast));
+    memset(t->fast_ac, 0, sizeof(t->fast_ac));
+    for (int len = 1; len <= 16; len++) {
+        t->valoff[len] = k - code;
+        // Reject over-subscribed tables before any of their codes are written
+        if (code + bits[len - 1] > 1 << len || k + bits[len - 1] > 256) return -1;
+        for (int i = 0; i < bits[len - 1]; i++, k++, code++) {
+            t->vals[k] = vals[k];
+            if (len <= FAST_BITS) {
+                int first = code << (FAST_BITS - len);
+                for (int j = 0; j < 1 << (FAST_BITS - len); j++)
+                    t->fast[first + j] = (unsigned short)((len << 8) | vals[k]);
+            }
+        }
+        t->maxcode[len] = bits[len - 1] ? code - 1 : -1;
+        code <<= 1;
+    }
+
+    // AC symbols whose code and magnitude bits both fit in the lookup
+    for (int i = 0; i < 1 << FAST_BITS; i++) {
+        int len = t->fast[i] >> 8, rs = t->fast[i] & 0xFF;
+        int size = rs & 15;
+        if (!len || !size || len + size > FAST_BITS) continue;
+        int v = (i >> (FAST_BITS - len - size)) & ((1 << size) - 1);
+        if (v < 1 << (size - 1)) v -= (1 << size) - 1;
+        t->fast_ac[i] = (int)((unsigned)v << 8) | (rs & 0xF0) | (len + size);
+    }
+    t->present = 1;
+    return 0;
+}
+
+static void refill(BitReader *r) {
+    while (r->bits <= 56) {
+        unsigned c = 0;
+        if (!r->marker && r->p < r->end) {
+            c = *r->p;
+            if (c != 0xFF) {
+                r->p++;
+            } else if (r->p + 1 < r->end && r->p[1] == 0x00) {
+                r->p += 2;
+            } else {
+                r->marker = 1;
+                c = 0;
+            }
+        }
+        r->acc |= (uint64_t)c << (56 - r->bits);
+        r->bits += 8;
+    }
+}
+
+static void skip_bits(BitReader *r, int n) {
+    r->acc <<= n;
+    r->bits -= n;
+}
+
+// Caller guarantees at least 16 bits buffered
+static int huff_decode(BitReader *r, const HuffTable *t) {
+    unsigned e = t->fast[r->acc >> (64 - FAST_BITS)];
+    if (e) {
+        skip_bits(r, e >> 8);
+        return e & 0xFF;
+    }
+    for (int len = FAST_BITS + 1; len <= 16; len++) {
+        int code = (int)(r->acc >> (64 - len));
+        if (code <= t->maxcode[len]) {
+            skip_bits(r, len);
+            return t->vals[t->valoff[len] + code];
+        }
+    }
+    return -1;
+}
+
+static int receive_extend(BitReader *r, int n) {
+    int v = (int)(r->acc >> (64 - n));
+    skip_bits(r, n);
+    return v < 1 << (n - 1) ? v - (1 << n) + 1 : v;
+}
+
+// Decodes one block. coef (natural order, zeroed) may be NULL when the AC
+// terms are not needed; they are then only skipped. Returns 1 if an AC term
+// was stored, 0 for a flat block, -1 on corrupt data.
+static int decode_block(BitReader *r, JpegComponent *c, const HuffTable *dc,
+                        const HuffTable *ac, int *coef) {
+    int has_ac = 0;
+    if (r->bits < 32) refill(r);
+    int s = huff_decode(r, dc);
+    if (s < 0 || s > 11) return -1;
+    if (s) c->pred += receive_extend(r, s);
+    if (coef) coef[0] = c->pred;
+
+    for (int k = 1; k < 64; k++) {
+        if (r->bits < 32) refill(r);
+        int f = ac->fast_ac[r->acc >> (64 - FAST_BITS)];
+        if (f) {
+            k += (f >> 4) & 15;
+            if (k > 63) return -1;
+            skip_bits(r, f & 15);
+            if (coef) coef[webcam_jpeg_zigzag[k]] = f >> 8;
+            has_ac = 1;
+            continue;
+        }
+        int rs = huff_decode(r, ac);
+        if (rs < 0) return -1;
+        int run = rs >> 4, size = rs & 15;
+        if (!size) {
+            if (run != 15) break;       // EOB
+            k += 15;
+            continue;
+        }
+        k += run;
+        if (k > 63) return -1;
+        if (coef) coef[webcam_jpeg_zigzag[k]] = receive_extend(r, size);
+        else skip_bits(r, size);
+        has_ac = 1;
+    }
+    return has_ac;
+}
+
+// ---------------------------------------------------------------------------
+// Inverse DCT at 8x8, 4x4, 2x2 and 1x1
+// ---------------------------------------------------------------------------
+
+static void idct_1d(const float *in, int step, float *out, int ostep) {
+    // Even part
+    float tmp10 = in[0] + in[4 * step];
+    float tmp11 = in[0] - in[4 * step];
+    float tmp13 = in[2 * step] + in[6 * step];
+    float tmp12 = (in[2 * step] - in[6 * step]) * 1.414213562f - tmp13;
+    float tmp0 = tmp10 + tmp13, tmp3 = tmp10 - tmp13;
+    float tmp1 = tmp11 + tmp12, tmp2 = tmp11 - tmp12;
+
+    // Odd part
+    float z13 = in[5 * step] + in[3 * step];
+    float z10 = in[5 * step] - in[3 * step];
+    float z11 = in[1 * step] + in[7 * step];
+    float z12 = in[1 * step] - in[7 * step];
+    float tmp7 = z11 + z13;
+    float tmp11o = (z11 - z13) * 1.414213562f;
+    float z5 = (z10 + z12) * 1.847759065f;
+    float tmp10o = z5 - z12 * 1.082392200f;
+    float tmp12o = z5 - z10 * 2.613125930f;
+    float tmp6 = tmp12o - tmp7;
+    float tmp5 = tmp11o - tmp6;
+    float tmp4 = tmp10o - tmp5;
+
+    out[0 * ostep] = tmp0 + tmp7;
+    out[7 * ostep] = tmp0 - tmp7;
+    out[1 * ostep] = tmp1 + tmp6;
+    out[6 * ostep] = tmp1 - tmp6;
+    out[2 * ostep] = tmp2 + tmp5;
+    out[5 * ostep] = tmp2 - tmp5;
+    out[3 * ostep] = tmp3 + tmp4;
+    out[4 * ostep] = tmp3 - tmp4;
+}
+
+static void idct_8x8(const int *coef, const float *qmul, unsigned char *dst, int stride) {
+    float in[64], tmp[64], row[8];
+    for (int i = 0; i < 64; i++) in[i] = coef[i] * qmul[i];
+    for (int u = 0; u < 8; u++) {                                       // Columns
+        const float *col = in + u;
+        if (col[8] == 0.0f && col[16] == 0.0f && col[24] == 0.0f && col[32] == 0.0f &&
+            col[40] == 0.0f && col[48] == 0.0f && col[56] == 0.0f) {
+            for (int y = 0; y < 8; y++) tmp[y * 8 + u] = col[0];
+            continue;
+        }
+        idct_1d(col, 8, tmp + u, 8);
+    }
+    for (int y = 0; y < 8; y++) {
+        idct_1d(tmp + y * 8, 1, row, 1);                                  // Rows
+        for (int x = 0; x < 8; x++) dst[y * stride + x] = to_pixel(row[x]);
+    }
+}
+
+// n-point IDCT of the low n x n coefficients, n = 2 or 4
+static void idct_reduced(const int *coef, const unsigned short *q, const float *basis, int n,
+                         unsigned char *dst, int stride) {
+    float tmp[4][4];
+    for (int v = 0; v < n; v++) {
+        for (int x = 0; x < n; x++) {
+            float s = 0.0f;
+            for (int u = 0; u < n; u++) s += basis[x * n + u] * (float)(coef[v * 8 + u] * q[v * 8 + u]);
+            tmp[v][x] = s;
+        }
+    }
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            float s = 0.0f;
+            for (int v = 0; v < n; v++) s += basis[y * n + v] * tmp[v][x];
+            dst[y * stride + x] = to_pixel(s);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Scan decoding
+// ---------------------------------------------------------------------------
+
+static void reader_restart(BitReader *r) {
+    while (r->p + 1 < r->end && !(r->p[0] == 0xFF && r->p[1] >= 0xD0 && r->p[1] <= 0xD7)) r->p++;
+    if (r->p + 1 < r->end) r->p += 2;
+    r->acc = 0;
+    r->bits = 0;
+    r->marker = 0;
+}
+
+static int decode_unit(WebcamJpegDecoder *dec, BitReader *r, JpegComponent *c, int bx, int by) {
+    int coef[64];
+    const int need_ac = c->needed && dec->scale < 8;
+    if (need_ac) memset(coef, 0, sizeof(coef));
+    int has_ac = decode_block(r, c, &dec->dc[c->td], &dec->ac[c->ta], need_ac ? coef : NULL);
+    if (has_ac < 0) return -1;
+    if (!c->needed) return 0;
+
+    const int n = dec->n;
+    unsigned char *dst = c->plane + (size_t)by * n * c->stride + (size_t)bx * n;
+    if (!need_ac || !has_ac) {
+        // DC only (1/8 scale or flat block): DC / 8 + 128, rounded
+        int v = c->pred * dec->qt[c->tq][0] + 1024 + 4;
+        unsigned char px = clamp_u8(v < 0 ? 0 : v >> 3);
+        for (int y = 0; y < n; y++) memset(dst + (size_t)y * c->stride, px, n);
+        return 0;
+    }
+    switch (dec->scale) {
+        case 4: idct_reduced(coef, dec->qt[c->tq], idct2_basis, 2, dst, c->stride); break;
+        case 2: idct_reduced(coef, dec->qt[c->tq], idct4_basis, 4, dst, c->stride); break;
+        default: idct_8x8(coef, dec->qmul[c->tq], dst, c->stride); break;
+    }
+    return 0;
+}
+
+// Returns the end of the entropy-coded data, or NULL on error
+static const unsigned char* decode_scan(WebcamJpegDecoder *dec, JpegComponent **scan, int ns,
+                                        const unsigned char *p, const unsigned char *end) {
+    BitReader r = { p, end, 0, 0, 0 };
+    for (int i = 0; i < ns; i++) scan[i]->pred = 0;
+
+    int units_x, units_y;
+    if (ns == 1) {
+        // Non-interleaved: one block per MCU over the component's own extent
+        JpegComponent *c = scan[0];
+        int cw = (dec->width * c->h + dec->hmax - 1) / dec->hmax;
+        int ch = (dec->height * c->v + dec->vmax - 1) / dec->vmax;
+        units_x = (cw + 7) / 8;
+        units_y = (ch + 7) / 8;
+    } else {
+        units_x = (dec->width + dec->hmax * 8 - 1) / (dec->hmax * 8);
+        units_y = (dec->height + dec->vmax * 8 - 1) / (dec->vmax * 8);
+    }
+
+    int count = 0;
+    for (int my = 0; my < units_y; my++) {
+        for (int mx = 0; mx < units_x; mx++, count++) {
+            if (dec->restart_interval && count && count % dec->restart_interval == 0) {
+                reader_restart(&r);
+                for (int i = 0; i < ns; i++) scan[i]->pred = 0;
+            }
+            if (ns == 1) {
+                if (decode_unit(dec, &r, scan[0], mx, my) < 0) return NULL;
+                continue;
+            }
+            for (int i = 0; i < ns; i++) {
+                JpegComponent *c = scan[i];
+                for (int by = 0; by < c->v; by++)
+                    for (int bx = 0; bx < c->h; bx++)
+                        if (decode_unit(dec, &r, c, mx * c->h + bx, my * c->v + by) < 0) return NULL;
+            }
+        }
+    }
+
+    // Step over padding and RSTn up to the next real marker
+    p = r.p;
+    while (p + 1 < end && !(p[0] == 0xFF && p[1] != 0x00 && (p[1] < 0xD0 || p[1] > 0xD7))) p++;
+    for (int i = 0; i < ns; i++) scan[i]->decoded = 1;
+    return p;
+}
+
+// ---------------------------------------------------------------------------
+// Marker segments
+// ---------------------------------------------------------------------------
+
+static int parse_dqt(WebcamJpegDecoder *dec, const unsigned char *p, int len) {
+    while (len > 0) {
+        int pq = p[0] >> 4, tq = p[0] & 15;
+        int size = 1 + (pq ? 128 : 64);
+        if (tq > 3 || pq > 1 || len < size) return -1;
+        for (int k = 0; k < 64; k++) {
+            int q = pq ? (p[1 + k * 2] << 8) | p[2 + k * 2] : p[1 + k];
+            int nat = webcam_jpeg_zigzag[k];
+            dec->qt[tq][nat] = (unsigned short)q;
+            dec->qmul[tq][nat] = q * aan_scale[nat >> 3] * aan_scale[nat & 7] / 8.0f;
+        }
+        p += size;
+        len -= size;
+    }
+    return 0;
+}
+
+static int parse_dht(WebcamJpegDecoder *dec, const unsigned char *p, int len) {
+    while (len > 0) {
+        if (len < 17) return -1;
+        int tc = p[0] >> 4, th = p[0] & 15;
+        if (tc > 1 || th > 3) return -1;
+        int count = 0;
+        for (int i = 0; i < 16; i++) count += p[1 + i];
+        if (count > 256 || len < 17 + count) return -1;
+        if (build_table(tc ? &dec->ac[th] : &dec->dc[th], p + 1, p + 17) < 0) return -1;
+        p += 17 + count;
+        len -= 17 + count;
+    }
+    return 0;
+}
+
+static int parse_sof(WebcamJpegDecoder *dec, const unsigned char *p, int len, int gray) {
+    if (len < 6 || p[0] != 8) return -1;
+    dec->height = (p[1] << 8) | p[2];
+    dec->width = (p[3] << 8) | p[4];
+    dec->ncomp = p[5];
+    if (!dec->width || !dec->height) return -1;       // DNL not supported
+    if ((dec->ncomp != 1 && dec->ncomp != 3) || len < 6 + dec->ncomp * 3) return -1;
+
+    dec->hmax = dec->vmax = 1;
+    for (int i = 0; i < dec->ncomp; i++) {
+        JpegComponent *c = &dec->comp[i];
+        c->id = p[6 + i * 3];
+        c->h = p[7 + i * 3] >> 4;
+        c->v = p[7 + i * 3] & 15;
+        c->tq = p[8 + i * 3];
+        if (c->h < 1 || c->h > 4 || c->v < 1 || c->v > 4 || c->tq > 3) return -1;
+        if (c->h > dec->hmax) dec->hmax = c->h;
+        if (c->v > dec->vmax) dec->vmax = c->v;
+    }
+
+    int mcus_x = (dec->width + dec->hmax * 8 - 1) / (dec->hmax * 8);
+    int mcus_y = (dec->height + dec->vmax * 8 - 1) / (dec->vmax * 8);
+    for (int i = 0; i < dec->ncomp; i++) {
+        JpegComponent *c = &dec->comp[i];
+        if (dec->hmax % c->h || dec->vmax % c->v) return -1;
+        c->needed = i == 0 || !gray;
+        c->decoded = 0;
+        c->plane = NULL;
+        if (!c->needed) continue;
+
+        c->stride = mcus_x * c->h * dec->n;
+        c->rows = mcus_y * c->v * dec->n;
+        size_t bytes = (size_t)c->stride * c->rows;
+        if (bytes > dec->buf_cap[i]) {
+            unsigned char *b = (unsigned char*)realloc(dec->buf[i], bytes);
+            if (!b) return -1;
+            dec->buf[i] = b;
+            dec->buf_cap[i] = bytes;
+        }
+        c->plane = dec->buf[i];
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Output
+// ---------------------------------------------------------------------------
+
+static int log2i(int v) { return v >= 4 ? 2 : v >> 1; }
+
+// Resamples a component plane to a w x h plane sampled every fx x fy output
+// pixels (1 or 2): 2x2 / 2x1 averaged when the source is denser, replicated
+// when it is sparser.
+static void resample_plane(const WebcamJpegDecoder *dec, const JpegComponent *c,
+                           int fx, int fy, unsigned char *dst, int w, int h) {
+    const int lx = log2i(fx) - log2i(dec->hmax / c->h);
+    const int ly = log2i(fy) - log2i(dec->vmax / c->v);
+
+    if (!lx && !ly && w <= c->stride && h <= c->rows) {
+        for (int y = 0; y < h; y++) memcpy(dst + (size_t)y * w, c->plane + (size_t)y * c->stride, w);
+        return;
+    }
+
+    for (int y = 0; y < h; y++) {
+        int y0 = ly >= 0 ? y << ly : y >> -ly;
+        int y1 = ly > 0 ? y0 + 1 : y0;
+        if (y0 >= c->rows) y0 = c->rows - 1;
+        if (y1 >= c->rows) y1 = c->rows - 1;
+        const unsigned char *r0 = c->plane + (size_t)y0 * c->stride;
+        const unsigned char *r1 = c->plane + (size_t)y1 * c->stride;
+        unsigned char *d = dst + (size_t)y * w;
+        for (int x = 0; x < w; x++) {
+            int x0 = lx >= 0 ? x << lx : x >> -lx;
+            int x1 = lx > 0 ? x0 + 1 : x0;
+            if (x0 >= c->stride) x0 = c->stride - 1;
+            if (x1 >= c->stride) x1 = c->stride - 1;
+            d[x] = (unsigned char)((r0[x0] + r0[x1] + r1[x0] + r1[x1] + 2) >> 2);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+WEBCAM_API WebcamJpegDecoder* webcam_jpeg_decoder_create(void) {
+    WebcamJpegDecoder *dec = (WebcamJpegDecoder*)calloc(1, sizeof(WebcamJpegDecoder));
+    if (!dec) return NULL;
+    for (int t = 0; t < 2; t++) {
+        build_table(&dec->std_dc[t], webcam_jpeg_dc_bits[t], webcam_jpeg_dc_vals);
+        build_table(&dec->std_ac[t], webcam_jpeg_ac_bits[t], webcam_jpeg_ac_vals[t]);
+    }
+    return dec;
+}
+
+WEBCAM_API int webcam_jpeg_decode(WebcamJpegDecoder *dec, const WebcamFrame *src, int scale,
+                                  WebcamPixelFormat dst_format, unsigned char *dst,
+                                  size_t dst_size, WebcamFrame *out) {
+    if (!dec || !src || !src->data || src->format != WEBCAM_FMT_MJPEG || src->size < 4) return -1;
+    if (scale != 1 && scale != 2 && scale != 4 && scale != 8) return -1;
+    if (dst_format != WEBCAM_FMT_GRAY8 && dst_format != WEBCAM_FMT_YUV420) return -1;
+
+    const unsigned char *p = src->data, *end = src->data + src->size;
+    if (p[0] != 0xFF || p[1] != 0xD8) return -1;
+    p += 2;
+
+    const int gray = dst_format == WEBCAM_FMT_GRAY8;
+    int w = 0, h = 0;
+    dec->scale = scale;
+    dec->n = 8 / scale;
+    dec->ncomp = 0;
+    dec->restart_interval = 0;
+    dec->dc[0] = dec->std_dc[0];
+    dec->dc[1] = dec->std_dc[1];
+    dec->ac[0] = dec->std_ac[0];
+    dec->ac[1] = dec->std_ac[1];
+    dec->dc[2].present = dec->dc[3].present = 0;
+    dec->ac[2].present = dec->ac[3].present = 0;
+
+    for (;;) {
+        while (p < end && *p != 0xFF) p++;
+        while (p < end && *p == 0xFF) p++;
+        if (p >= end) break;                    // Truncated: keep what was decoded
+        int m = *p++;
+        if (m == 0xD9) break;                   // EOI
+        if (m == 0x01 || (m >= 0xD0 && m <= 0xD8)) continue;
+        if (end - p < 2) return -1;
+        int len = (p[0] << 8) | p[1];
+        if (len < 2 || len > end - p) return -1;
+        const unsigned char *seg = p + 2;
+        int seg_len = len - 2;
+        p += len;
+
+        switch (m) {
+            case 0xDB:
+                if (parse_dqt(dec, seg, seg_len) < 0) return -1;
+                break;
+            case 0xC4:
+                if (parse_dht(dec, seg, seg_len) < 0) return -1;
+                break;
+            case 0xDD:
+                if (seg_len < 2) return -1;
+                dec->restart_interval = (seg[0] << 8) | seg[1];
+                break;
+            case 0xC0:
+            case 0xC1: {
+                if (dec->ncomp || parse_sof(dec, seg, seg_len, gray) < 0) return -1;
+                w = (dec->width + scale - 1) / scale;
+                h = (dec->height + scale - 1) / scale;
+                if (!gray) {
+                    w += w & 1;
+                    h += h & 1;
+                }
+                size_t need = webcam_frame_size(dst_format, w, h);
+                if (out) {
+                    memset(out, 0, sizeof(*out));
+                    out->width = w;
+                    out->height = h;
+                    out->size = (int)need;
+                    out->format = dst_format;
+                }
+                if (!dst || need > dst_size) return -1;
+                break;
+            }
+            case 0xDA: {
+                if (!dec->ncomp || seg_len < 1) return -1;
+                int ns = seg[0];
+                if (ns < 1 || ns > dec->ncomp || seg_len < 4 + ns * 2) return -1;
+                JpegComponent *scan[MAX_COMPONENTS];
+                for (int i = 0; i < ns; i++) {
+                    int id = seg[1 + i * 2], k = 0;
+                    while (k < dec->ncomp && dec->comp[k].id != id) k++;
+                    if (k == dec->ncomp) return -1;
+                    scan[i] = &dec->comp[k];
+                    scan[i]->td = seg[2 + i * 2] >> 4;
+                    scan[i]->ta = seg[2 + i * 2] & 15;
+                    if (scan[i]->td > 3 || scan[i]->ta > 3 ||
+                        !dec->dc[scan[i]->td].present || !dec->ac[scan[i]->ta].present) return -1;
+                }
+                // Sequential scans only: Ss = 0, Se = 63, Ah = Al = 0
+                const unsigned char *sp = seg + 1 + ns * 2;
+                if (sp[0] != 0 || sp[1] != 63 || sp[2] != 0) return -1;
+                p = decode_scan(dec, scan, ns, p, end);
+                if (!p) return -1;
+                break;
+            }
+            default:
+                // SOF2+ (progressive, lossless, arithmetic) are not supported
+                if (m >= 0xC2 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC) return -1;
+                break;                          // APPn, COM, ...
+        }
+    }
+
+    if (!dec->ncomp || !dec->comp[0].decoded) return -1;
+
+    const JpegComponent *y = &dec->comp[0];
+    resample_plane(dec, y, 1, 1, dst, w, h);
+    if (!gray) {
+        unsigned char *u = dst + (size_t)w * h;
+        unsigned char *v = u + (size_t)(w / 2) * (h / 2);
+        if (dec->ncomp == 3 && dec->comp[1].decoded && dec->comp[2].decoded) {
+            resample_plane(dec, &dec->comp[1], 2, 2, u, w / 2, h / 2);
+            resample_plane(dec, &dec->comp[2], 2, 2, v, w / 2, h / 2);
+        } else {
+            memset(u, 128, (size_t)(w / 2) * (h / 2) * 2);
+        }
+    }
+
+    if (out) {
+        out->data = dst;
+        out->timestamp_ms = src->timestamp_ms;
+        out->timestamp_us = src->timestamp_us;
+        out->control_generation = src->control_generation;
+    }
+    return 0;
+}
+
+WEBCAM_API void webcam_jpeg_decoder_destroy(WebcamJpegDecoder *dec) {
+    if (!dec) return;
+    for (int i = 0; i < MAX_COMPONENTS; i++) free(dec->buf[i]);
+    free(dec);
+}
@@ -0,0 +1,117 @@
+// ============================================================================
+// webcam_kernels.c - Row kernels shared by the scaling paths
+// ============================================================================
+// Second half of the two-pass bilinear scalers (mosaic tiles, tensors): the
+// horizontally sampled 8.8 rows from webcam_sample_row() are blended
+// vertically, converted from YUV and packed to RGB eight pixels at a time
+// (SSE2 on x86). Lines are planar int16, one plane per channel, so values
+// can leave 0..255 between the conversion and the saturating pack.
+// ============================================================================
+#include "webcam_internal.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define KERNELS_SSE2 1
+#endif
+
+#define LANES 8
+
+static unsigned char clamp8(int v) {
+    return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+void webcam_blend_rows(unsigned short *const a[3], unsigned short *const b[3],
+                       int fy, int n, short *const out[3]) {
+    // (a * (256 - fy) + b * fy) / 256 stays in 8.8, each product floored as
+    // _mm_mulhi_epu16 does, so a column's value never depends on whether it
+    // falls in the vector body or the tail; fy == 0 never reads b
+    for (int k = 0; k < 3; k++) {
+        short *o = out[k];
+        int i = 0;
+#ifdef KERNELS_SSE2
+        const __m128i wa = _mm_set1_epi16((short)((256 - fy) << 8));
+        const __m128i wb = _mm_set1_epi16((short)(fy << 8));
+        const __m128i half = _mm_set1_epi16(128);
+        for (; i + LANES <= n; i += LANES) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(a[k] + i));
+            if (fy) {
+                v = _mm_add_epi16(_mm_mulhi_epu16(v, wa),
+                                  _mm_mulhi_epu16(_mm_loadu_si128((const __m128i*)(b[k] + i)), wb));
+            }
+            _mm_storeu_si128((__m128i*)(o + i), _mm_srli_epi16(_mm_add_epi16(v, half), 8));
+        }
+#endif
+        for (; i < n; i++) {
+            int v = fy ? ((a[k][i] * (256 - fy)) >> 8) + ((b[k][i] * fy) >> 8) : a[k][i];
+            o[i] = (short)((v + 128) >> 8);
+        }
+    }
+}
+
+// BT.601 full range in 8.8 fixed point, as webcam_convert()
+void webcam_yuv_to_rgb(short *const c[3], int n) {
+    short *y = c[0], *u = c[1], *v = c[2];
+    int i = 0;
+#ifdef KERNELS_SSE2
+    const __m128i k128 = _mm_set1_epi16(128), one = _mm_set1_epi16(1);
+    const __m128i kr = _mm_set1_epi32(359 | (128 << 16));       // 359 v + 128
+    const __m128i kb = _mm_set1_epi32(454 | (128 << 16));       // 454 u + 128
+    const __m128i kg = _mm_set1_epi32(88 | (183 << 16));        // 88 u + 183 v
+    const __m128i r128 = _mm_set1_epi32(128);
+    for (; i + LANES <= n; i += LANES) {
+        __m128i Y = _mm_loadu_si128((const __m128i*)(y + i));
+        __m128i U = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(u + i)), k128);
+        __m128i V = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(v + i)), k128);
+        #define TERM(a, b, k, bias) _mm_packs_epi32( \
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, b), k), bias), 8), \
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, b), k), bias), 8))
+        __m128i cr = TERM(V, one, kr, _mm_setzero_si128());
+        __m128i cb = TERM(U, one, kb, _mm_setzero_si128());
+        __m128i cg = TERM(U, V, kg, r128);
+        #undef TERM
+        _mm_storeu_si128((__m128i*)(y + i), _mm_add_epi16(Y, cr));
+        _mm_storeu_si128((__m128i*)(u + i), _mm_sub_epi16(Y, cg));
+        _mm_storeu_si128((__m128i*)(v + i), _mm_add_epi16(Y, cb));
+    }
+#endif
+    for (; i < n; i++) {
+        int Y = y[i], U = u[i] - 128, V = v[i] - 128;
+        y[i] = (short)(Y + ((359 * V + 128) >> 8));
+        u[i] = (short)(Y - ((88 * U + 183 * V + 128) >> 8));
+        v[i] = (short)(Y + ((454 * U + 128) >> 8));
+    }
+}
+
+void webcam_pack_rgb(short *const c[3], int n, unsigned char *out, int bpp) {
+    const short *r = c[0], *g = c[1], *b = c[2];
+    int i = 0;
+#ifdef KERNELS_SSE2
+    const __m128i alpha = _mm_set1_epi8((char)255);
+    for (; i + LANES <= n; i += LANES) {
+        __m128i R = _mm_loadu_si128((const __m128i*)(r + i));
+        __m128i G = _mm_loadu_si128((const __m128i*)(g + i));
+        __m128i B = _mm_loadu_si128((const __m128i*)(b + i));
+        // Saturating packs clamp to 0..255
+        __m128i rg = _mm_unpacklo_epi8(_mm_packus_epi16(R, R), _mm_packus_epi16(G, G));
+        __m128i ba = _mm_unpacklo_epi8(_mm_packus_epi16(B, B), alpha);
+        __m128i lo = _mm_unpacklo_epi16(rg, ba), hi = _mm_unpackhi_epi16(rg, ba);
+        if (bpp == 4) {
+            _mm_storeu_si128((__m128i*)(out + i * 4), lo);
+            _mm_storeu_si128((__m128i*)(out + i * 4 + 16), hi);
+        } else {
+            unsigned char px[32], *d = out + i * 3;
+            _mm_storeu_si128((__m128i*)px, lo);
+            _mm_storeu_si128((__m128i*)(px + 16), hi);
+            for (int k = 0; k < LANES; k++, d += 3) {
+                d[0] = px[k * 4]; d[1] = px[k * 4 + 1]; d[2] = px[k * 4 + 2];
+            }
+        }
+    }
+#endif
+    for (unsigned char *d = out + i * bpp; i < n; i++, d += bpp) {
+        d[0] = clamp8(r[i]);
+        d[1] = clamp8(g[i]);
+        d[2] = clamp8(b[i]);
+        if (bpp == 4) d[3] = 255;
+    }
+}
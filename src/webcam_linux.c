@@ -3,31 +3,67 @@
 // ============================================================================
 #ifdef __linux__
 
-#include "webcam.h"
+#define _GNU_SOURCE
+#include "webcam_internal.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <sys/time.h>
 #include <linux/videodev2.h>
 
-#define MAX_BUFFERS 4
-
-struct Webcam {
-    int fd;
-    int actual_width;
-    int actual_height;
-    struct {
-        void *start;
-        size_t length;
-    } buffers[MAX_BUFFERS];
-    int buffer_count;
-    int current_buffer_index;
-    WebcamPixelFormat format;
-};
+int webcam_buffer_find(Webcam *cam, const unsigned char *data) {
+    for (int i = 0; i < cam->buffer_count; i++)
+        if (cam->buffers[i].start == (const void*)data) return i;
+    return -1;
+}
+
+void webcam_buffer_ref(Webcam *cam, int index) {
+    __atomic_add_fetch(&cam->buffers[index].refs, 1, __ATOMIC_ACQ_REL);
+}
+
+void webcam_buffer_unref(Webcam *cam, int index) {
+    if (index < 0 || index >= cam->buffer_count) return;
+
+    int refs = __atomic_load_n(&cam->buffers[index].refs, __ATOMIC_ACQUIRE);
+    do {
+        if (refs <= 0) return; // Already back in the driver
+    } while (!__atomic_compare_exchange_n(&cam->buffers[index].refs, &refs, refs - 1,
+                                          0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    if (refs != 1) return;
+
+    struct v4l2_buffer buf = {0};
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+    ioctl(cam->fd, VIDIOC_QBUF, &buf);
+}
+
+// Frame rate from a V4L2 interval, rounded (30000/1001 -> 30)
+static int interval_fps(const struct v4l2_fract *interval) {
+    if (!interval->numerator) return 0;
+    return (int)((interval->denominator + interval->numerator / 2) / interval->numerator);
+}
+
+static int set_interval(int fd, struct v4l2_fract interval) {
+    struct v4l2_streamparm parm = {0};
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (ioctl(fd, VIDIOC_G_PARM, &parm) == -1) return -1;
+    if (!(parm.parm.capture.capability & V4L2_CAP_TIMEPERFRAME)) return -1;
+    parm.parm.capture.timeperframe = interval;
+    return ioctl(fd, VIDIOC_S_PARM, &parm) == -1 ? -1 : 0;
+}
+
+static int set_frame_rate(int fd, int fps) {
+    struct v4l2_fract interval = { 1, (unsigned)fps };
+    return set_interval(fd, interval);
+}
 
 WEBCAM_API WebcamInfo* webcam_list_devices(int *count) {
     WebcamInfo *temp_list = malloc(20 * sizeof(WebcamInfo));
@@ -74,7 +110,7 @@ WEBCAM_API WebcamCapabilities* webcam_query_capabilities(int device_index) {
     struct v4l2_fmtdesc fmtdesc = {0};
     fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     
-    int max_formats = 200;
+    int max_formats = 512;
     WebcamFormatInfo *formats = malloc(max_formats * sizeof(WebcamFormatInfo));
     if (!formats) { close(fd); free(caps); return NULL; }
     
@@ -104,6 +140,36 @@ WEBCAM_API WebcamCapabilities* webcam_query_capabilities(int device_index) {
             case V4L2_PIX_FMT_MJPEG:
                 fmt_type = WEBCAM_FMT_MJPEG;
                 break;
+            case V4L2_PIX_FMT_NV12:
+                fmt_type = WEBCAM_FMT_NV12;
+                break;
+            case V4L2_PIX_FMT_GREY:
+                fmt_type = WEBCAM_FMT_GRAY8;
+                break;
+            case V4L2_PIX_FMT_SRGGB8:
+                fmt_type = WEBCAM_FMT_SRGGB8;
+                break;
+            case V4L2_PIX_FMT_SBGGR8:
+                fmt_type = WEBCAM_FMT_SBGGR8;
+                break;
+            case V4L2_PIX_FMT_SGRBG8:
+                fmt_type = WEBCAM_FMT_SGRBG8;
+                break;
+            case V4L2_PIX_FMT_SGBRG8:
+                fmt_type = WEBCAM_FMT_SGBRG8;
+                break;
+            case V4L2_PIX_FMT_SRGGB10:
+                fmt_type = WEBCAM_FMT_SRGGB10;
+                break;
+            case V4L2_PIX_FMT_SBGGR10:
+                fmt_type = WEBCAM_FMT_SBGGR10;
+                break;
+            case V4L2_PIX_FMT_SGRBG10:
+                fmt_type = WEBCAM_FMT_SGRBG10;
+                break;
+            case V4L2_PIX_FMT_SGBRG10:
+                fmt_type = WEBCAM_FMT_SGBRG10;
+                break;
             default:
                 recognized = 0;
                 break;
@@ -116,10 +182,34 @@ WEBCAM_API WebcamCapabilities* webcam_query_capabilities(int device_index) {
             while (ioctl(fd, VIDIOC_ENUM_FRAMESIZES, &frmsize) == 0 && 
                    format_count < max_formats) {
                 if (frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
-                    formats[format_count].format = fmt_type;
-                    formats[format_count].width = frmsize.discrete.width;
-                    formats[format_count].height = frmsize.discrete.height;
-                    formats[format_count].fps = 30;
+                    // One entry per discrete frame interval; stepwise ranges
+                    // report their fastest rate, and 0 means unknown
+                    struct v4l2_frmivalenum ival = {0};
+                    ival.pixel_format = fmtdesc.pixelformat;
+                    ival.width = frmsize.discrete.width;
+                    ival.height = frmsize.discrete.height;
+                    int added = 0;
+                    while (format_count < max_formats &&
+                           ioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &ival) == 0) {
+                        int fps = ival.type == V4L2_FRMIVAL_TYPE_DISCRETE
+                                      ? interval_fps(&ival.discrete)
+                                      : interval_fps(&ival.stepwise.min);
+                        formats[format_count].format = fmt_type;
+                        formats[format_count].width = frmsize.discrete.width;
+                        formats[format_count].height = frmsize.discrete.height;
+                        formats[format_count].fps = fps;
+                        format_count++;
+                        added++;
+                        if (ival.type != V4L2_FRMIVAL_TYPE_DISCRETE) break;
+                        ival.index++;
+                    }
+                    if (!added && format_count < max_formats) {
+                        formats[format_count].format = fmt_type;
+                        formats[format_count].width = frmsize.discrete.width;
+                        formats[format_count].height = frmsize.discrete.height;
+                        formats[format_count].fps = 0;
+                        format_count++;
+                    }
                     
                     if (frmsize.discrete.width > caps->max_width)
                         caps->max_width = frmsize.discrete.width;
@@ -129,8 +219,6 @@ WEBCAM_API WebcamCapabilities* webcam_query_capabilities(int device_index) {
                         caps->min_width = frmsize.discrete.width;
                     if (frmsize.discrete.height < caps->min_height)
                         caps->min_height = frmsize.discrete.height;
-                    
-                    format_count++;
                 }
                 frmsize.index++;
             }
@@ -154,12 +242,19 @@ WEBCAM_API WebcamCapabilities* webcam_query_capabilities(int device_index) {
 
 WEBCAM_API Webcam* webcam_open(int width, int height, int device_index,
                                WebcamPixelFormat format) {
+    return webcam_open_fps(width, height, device_index, format, 0);
+}
+
+WEBCAM_API Webcam* webcam_open_fps(int width, int height, int device_index,
+                                   WebcamPixelFormat format, int fps) {
     Webcam *cam = calloc(1, sizeof(Webcam));
     if (!cam) return NULL;
     
     char dev_name[20];
     sprintf(dev_name, "/dev/video%d", device_index);
-    cam->fd = open(dev_name, O_RDWR);
+    // Non-blocking: VIDIOC_DQBUF reports EAGAIN instead of sleeping, waits
+    // happen in poll() with the caller's timeout
+    cam->fd = open(dev_name, O_RDWR | O_NONBLOCK);
     if (cam->fd == -1) { 
         free(cam); 
         return NULL; 
@@ -183,12 +278,43 @@ WEBCAM_API Webcam* webcam_open(int width, int height, int device_index,
         case WEBCAM_FMT_MJPEG:
             v4l2_fmt = V4L2_PIX_FMT_MJPEG;
             break;
+        case WEBCAM_FMT_NV12:
+            v4l2_fmt = V4L2_PIX_FMT_NV12;
+            break;
+        case WEBCAM_FMT_GRAY8:
+            v4l2_fmt = V4L2_PIX_FMT_GREY;
+            break;
+        case WEBCAM_FMT_SRGGB8:
+            v4l2_fmt = V4L2_PIX_FMT_SRGGB8;
+            break;
+        case WEBCAM_FMT_SBGGR8:
+            v4l2_fmt = V4L2_PIX_FMT_SBGGR8;
+            break;
+        case WEBCAM_FMT_SGRBG8:
+            v4l2_fmt = V4L2_PIX_FMT_SGRBG8;
+            break;
+        case WEBCAM_FMT_SGBRG8:
+            v4l2_fmt = V4L2_PIX_FMT_SGBRG8;
+            break;
+        case WEBCAM_FMT_SRGGB10:
+            v4l2_fmt = V4L2_PIX_FMT_SRGGB10;
+            break;
+        case WEBCAM_FMT_SBGGR10:
+            v4l2_fmt = V4L2_PIX_FMT_SBGGR10;
+            break;
+        case WEBCAM_FMT_SGRBG10:
+            v4l2_fmt = V4L2_PIX_FMT_SGRBG10;
+            break;
+        case WEBCAM_FMT_SGBRG10:
+            v4l2_fmt = V4L2_PIX_FMT_SGBRG10;
+            break;
         default:
             v4l2_fmt = V4L2_PIX_FMT_YUYV;
             break;
     }
     
     cam->format = format;
+    webcam_controls_init(&cam->controls);
 
     // Set format
     struct v4l2_format fmt = {0};
@@ -207,6 +333,9 @@ WEBCAM_API Webcam* webcam_open(int width, int height, int device_index,
     cam->actual_width = fmt.fmt.pix.width;
     cam->actual_height = fmt.fmt.pix.height;
 
+    // Best effort: the driver picks the closest interval it supports
+    if (fps > 0) set_frame_rate(cam->fd, fps);
+
     // Request buffers
     struct v4l2_requestbuffers req = {0};
     req.count = MAX_BUFFERS;
@@ -243,9 +372,10 @@ WEBCAM_API Webcam* webcam_open(int width, int height, int device_index,
         }
 
         cam->buffers[i].length = buf.length;
+        // Populated up front: no page faults when the first frames are touched
         cam->buffers[i].start = mmap(NULL, buf.length, 
                                      PROT_READ | PROT_WRITE,
-                                     MAP_SHARED, cam->fd, buf.m.offset);
+                                     MAP_SHARED | MAP_POPULATE, cam->fd, buf.m.offset);
         
         if (cam->buffers[i].start == MAP_FAILED) {
             for (int j = 0; j < i; j++)
@@ -277,29 +407,75 @@ WEBCAM_API Webcam* webcam_open(int width, int height, int device_index,
     return cam;
 }
 
+uint64_t webcam_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
 WEBCAM_API int webcam_capture(Webcam *cam, WebcamFrame *frame) {
+    return webcam_capture_timeout(cam, frame, 2000000);
+}
+
+WEBCAM_API int webcam_try_capture(Webcam *cam, WebcamFrame *frame) {
+    return webcam_capture_timeout(cam, frame, 0);
+}
+
+WEBCAM_API int webcam_capture_timeout(Webcam *cam, WebcamFrame *frame, long timeout_us) {
     if (!cam || !frame) return -1;
+    webcam_controls_apply(cam);
+
+    // The timeout covers decimated frames too
+    const uint64_t deadline = timeout_us > 0 ? webcam_now_us() + (uint64_t)timeout_us : 0;
+    struct v4l2_buffer buf;
+    int woken = 0;  // Next dequeue follows a ppoll wakeup
+    for (;;) {
+        // Dequeue buffer
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
 
-    // Wait for frame
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(cam->fd, &fds);
-    struct timeval tv = {2, 0};
+        if (ioctl(cam->fd, VIDIOC_DQBUF, &buf) == -1) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN) return -1;
+            if (timeout_us == 0) return -2; // Would block
+
+            // Wait for frame
+            struct timespec left, *wait = NULL;
+            if (timeout_us > 0) {
+                uint64_t now = webcam_now_us();
+                if (now >= deadline) return -2; // Timeout
+                left.tv_sec = (time_t)((deadline - now) / 1000000u);
+                left.tv_nsec = (long)((deadline - now) % 1000000u) * 1000;
+                wait = &left;
+            }
+            struct pollfd pfd = { cam->fd, POLLIN, 0 };
+            int r = ppoll(&pfd, 1, wait, NULL);
+            if (r == -1 && errno != EINTR) return -1;
+            if (r == 0) return -2; // Timeout
+            woken = r > 0;
+            continue;
+        }
 
-    int r = select(cam->fd + 1, &fds, NULL, NULL, &tv);
-    if (r == -1) return -1;
-    if (r == 0) return -2; // Timeout
+        // Wakeup latency: only frames this call slept for. One already queued
+        // on entry measures how late the caller was, not the wakeup.
+        uint64_t ts = (uint64_t)buf.timestamp.tv_sec * 1000000u + buf.timestamp.tv_usec;
+        if (woken &&
+            (buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+            uint64_t now = webcam_now_us();
+            webcam_latency_record(&cam->latency, now > ts ? now - ts : 0,
+                                  (buf.flags & V4L2_BUF_FLAG_TSTAMP_SRC_MASK) ==
+                                      V4L2_BUF_FLAG_TSTAMP_SRC_SOE);
+        }
+        woken = 0;
+        if (!webcam_decimator_skip(&cam->decimator, ts)) break;
 
-    // Dequeue buffer
-    struct v4l2_buffer buf = {0};
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
-    
-    if (ioctl(cam->fd, VIDIOC_DQBUF, &buf) == -1) {
-        return -1;
+        // Decimated: straight back to the driver, never mapped or touched
+        ioctl(cam->fd, VIDIOC_QBUF, &buf);
     }
 
     cam->current_buffer_index = buf.index;
+    __atomic_store_n(&cam->buffers[buf.index].refs, 1, __ATOMIC_RELEASE);
 
     // Fill frame info (ZERO-COPY)
     frame->data = (const unsigned char*)cam->buffers[buf.index].start;
@@ -308,6 +484,9 @@ WEBCAM_API int webcam_capture(Webcam *cam, WebcamFrame *frame) {
     frame->format = cam->format;
     frame->timestamp_ms = (buf.timestamp.tv_sec * 1000) + 
                          (buf.timestamp.tv_usec / 1000);
+    frame->timestamp_us = (uint64_t)buf.timestamp.tv_sec * 1000000u +
+                          buf.timestamp.tv_usec;
+    frame->control_generation = webcam_controls_at(&cam->controls, frame->timestamp_us);
     
     // Calculate size based on format
     switch (cam->format) {
@@ -321,8 +500,22 @@ WEBCAM_API int webcam_capture(Webcam *cam, WebcamFrame *frame) {
             frame->size = cam->actual_width * cam->actual_height * 2;
             break;
         case WEBCAM_FMT_YUV420:
+        case WEBCAM_FMT_NV12:
             frame->size = cam->actual_width * cam->actual_height * 3 / 2;
             break;
+        case WEBCAM_FMT_GRAY8:
+        case WEBCAM_FMT_SRGGB8:
+        case WEBCAM_FMT_SBGGR8:
+        case WEBCAM_FMT_SGRBG8:
+        case WEBCAM_FMT_SGBRG8:
+            frame->size = cam->actual_width * cam->actual_height;
+            break;
+        case WEBCAM_FMT_SRGGB10:
+        case WEBCAM_FMT_SBGGR10:
+        case WEBCAM_FMT_SGRBG10:
+        case WEBCAM_FMT_SGBRG10:
+            frame->size = cam->actual_width * cam->actual_height * 2;
+            break;
         case WEBCAM_FMT_MJPEG:
             frame->size = buf.bytesused;
             break;
@@ -335,13 +528,12 @@ WEBCAM_API int webcam_capture(Webcam *cam, WebcamFrame *frame) {
 
 WEBCAM_API void webcam_release_frame(Webcam *cam) {
     if (!cam) return;
-    
-    struct v4l2_buffer buf = {0};
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
-    buf.index = cam->current_buffer_index;
-    
-    ioctl(cam->fd, VIDIOC_QBUF, &buf);
+    webcam_buffer_unref(cam, cam->current_buffer_index);
+}
+
+WEBCAM_API void webcam_return_frame(Webcam *cam, const WebcamFrame *frame) {
+    if (!cam || !frame) return;
+    webcam_buffer_unref(cam, webcam_buffer_find(cam, frame->data));
 }
 
 WEBCAM_API void webcam_close(Webcam *cam) {
@@ -352,6 +544,7 @@ WEBCAM_API void webcam_close(Webcam *cam) {
         for (int i = 0; i < cam->buffer_count; i++)
             munmap(cam->buffers[i].start, cam->buffers[i].length);
         
+        webcam_workers_destroy(cam->workers);
         close(cam->fd);
         free(cam);
     }
@@ -369,6 +562,107 @@ WEBCAM_API WebcamPixelFormat webcam_get_format(Webcam *cam) {
     return cam ? cam->format : WEBCAM_FMT_YUYV;
 }
 
+WEBCAM_API int webcam_set_threads(Webcam *cam, int threads) {
+    if (!cam) return -1;
+    webcam_workers_destroy(cam->workers);
+    cam->workers = webcam_workers_create(threads);
+    if (threads > 1 && !cam->workers) return -1;
+    if (!cam->rt.cpu_mask && !cam->rt.priority) return 0;
+    return webcam_workers_set_rt(cam->workers, &cam->rt);
+}
+
+WEBCAM_API int webcam_set_rt_profile(Webcam *cam, const WebcamRtProfile *profile) {
+    if (!cam || !profile) return -1;
+    cam->rt = *profile;
+    cam->rt.lock_memory = 0;    // Workers have nothing to lock
+    int r = webcam_workers_set_rt(cam->workers, &cam->rt);
+
+    // mlock also faults the pages in; unmapping on close drops the lock
+    if (profile->lock_memory) {
+        for (int i = 0; i < cam->buffer_count; i++)
+            if (mlock(cam->buffers[i].start, cam->buffers[i].length) != 0) r = -1;
+    }
+    return r;
+}
+
+WEBCAM_API int webcam_get_latency_stats(Webcam *cam, WebcamLatencyStats *stats, int reset) {
+    if (!cam || !stats) return -1;
+    webcam_latency_read(&cam->latency, stats, reset);
+    return 0;
+}
+
+WEBCAM_API int webcam_get_threads(Webcam *cam) {
+    return cam ? webcam_workers_count(cam->workers) : 0;
+}
+
+WebcamWorkers* webcam_get_workers(Webcam *cam) {
+    return cam ? cam->workers : NULL;
+}
+
+WebcamControls* webcam_get_controls(Webcam *cam) {
+    return &cam->controls;
+}
+
+WEBCAM_API int webcam_get_fd(Webcam *cam) {
+    return cam ? cam->fd : -1;
+}
+
+// Queues every buffer and starts streaming. On failure the stream is left
+// off with nothing queued (STREAMOFF takes back what was), ready for a retry.
+static int stream_start(Webcam *cam) {
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    for (int i = 0; i < cam->buffer_count; i++) {
+        struct v4l2_buffer buf = {0};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (ioctl(cam->fd, VIDIOC_QBUF, &buf) == -1) goto fail;
+    }
+    if (ioctl(cam->fd, VIDIOC_STREAMON, &type) == 0) return 0;
+fail:
+    ioctl(cam->fd, VIDIOC_STREAMOFF, &type);
+    return -1;
+}
+
+WEBCAM_API int webcam_set_fps(Webcam *cam, int fps) {
+    if (!cam || fps <= 0) return -1;
+    if (set_frame_rate(cam->fd, fps) == 0) return 0;
+    if (errno != EBUSY) return -1;
+
+    // Most drivers only change the interval with the stream stopped, which
+    // takes every buffer back: nothing may be held
+    for (int i = 0; i < cam->buffer_count; i++)
+        if (__atomic_load_n(&cam->buffers[i].refs, __ATOMIC_ACQUIRE) > 0) return -1;
+
+    struct v4l2_streamparm old = {0};
+    old.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (ioctl(cam->fd, VIDIOC_G_PARM, &old) == -1) return -1;
+
+    enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (ioctl(cam->fd, VIDIOC_STREAMOFF, &type) == -1) return -1;
+    int r = set_frame_rate(cam->fd, fps);
+    if (stream_start(cam) == 0) return r;
+
+    // The driver would not stream at the new rate: back to the old one
+    if (r == 0) set_interval(cam->fd, old.parm.capture.timeperframe);
+    stream_start(cam);
+    return -1;
+}
+
+WEBCAM_API int webcam_get_fps(Webcam *cam) {
+    if (!cam) return 0;
+    struct v4l2_streamparm parm = {0};
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (ioctl(cam->fd, VIDIOC_G_PARM, &parm) == -1) return 0;
+    return interval_fps(&parm.parm.capture.timeperframe);
+}
+
+WEBCAM_API int webcam_set_decimation(Webcam *cam, int every_nth, int max_fps) {
+    if (!cam) return -1;
+    webcam_decimator_set(&cam->decimator, every_nth, max_fps);
+    return 0;
+}
+
 WEBCAM_API long webcam_get_parameter(Webcam *cam, WebcamParameter param) {
     if (!cam) return -1;
     struct v4l2_control ctrl = {0};
@@ -381,14 +675,33 @@ WEBCAM_API long webcam_get_parameter(Webcam *cam, WebcamParameter param) {
         case WEBCAM_PARAM_ZOOM: ctrl.id = V4L2_CID_ZOOM_ABSOLUTE; break;
         case WEBCAM_PARAM_GAIN: ctrl.id = V4L2_CID_GAIN; break;
         case WEBCAM_PARAM_SHARPNESS: ctrl.id = V4L2_CID_SHARPNESS; break;
+        case WEBCAM_PARAM_HFLIP: ctrl.id = V4L2_CID_HFLIP; break;
+        case WEBCAM_PARAM_VFLIP: ctrl.id = V4L2_CID_VFLIP; break;
         default: return -1;
     }
     return (ioctl(cam->fd, VIDIOC_G_CTRL, &ctrl) == 0) ? ctrl.value : -1;
 }
 
-WEBCAM_API int webcam_set_parameter(Webcam *cam, WebcamParameter param, long value) {
-    if (!cam) return -1;
+// Runs on whichever thread drains the control queue (webcam_control.c);
+// V4L2 serializes control ioctls against streaming in the driver
+int webcam_apply_control(Webcam *cam, WebcamParameter param, long value, int set_auto) {
     struct v4l2_control ctrl = {0};
+    if (set_auto) {
+        switch (param) {
+            case WEBCAM_PARAM_EXPOSURE:
+                ctrl.id = V4L2_CID_EXPOSURE_AUTO;
+                ctrl.value = value ? V4L2_EXPOSURE_AUTO : V4L2_EXPOSURE_MANUAL;
+                break;
+            case WEBCAM_PARAM_FOCUS:
+                ctrl.id = V4L2_CID_FOCUS_AUTO;
+                ctrl.value = value ? 1 : 0;
+                break;
+            default:
+                return -1;
+        }
+        return (ioctl(cam->fd, VIDIOC_S_CTRL, &ctrl) == 0) ? 0 : -1;
+    }
+
     ctrl.value = value;
     switch(param) {
         case WEBCAM_PARAM_BRIGHTNESS: ctrl.id = V4L2_CID_BRIGHTNESS; break;
@@ -399,27 +712,11 @@ WEBCAM_API int webcam_set_parameter(Webcam *cam, WebcamParameter param, long val
         case WEBCAM_PARAM_ZOOM: ctrl.id = V4L2_CID_ZOOM_ABSOLUTE; break;
         case WEBCAM_PARAM_GAIN: ctrl.id = V4L2_CID_GAIN; break;
         case WEBCAM_PARAM_SHARPNESS: ctrl.id = V4L2_CID_SHARPNESS; break;
+        case WEBCAM_PARAM_HFLIP: ctrl.id = V4L2_CID_HFLIP; break;
+        case WEBCAM_PARAM_VFLIP: ctrl.id = V4L2_CID_VFLIP; break;
         default: return -1;
     }
     return (ioctl(cam->fd, VIDIOC_S_CTRL, &ctrl) == 0) ? 0 : -1;
 }
 
-WEBCAM_API int webcam_set_auto(Webcam *cam, WebcamParameter param, int is_auto) {
-    if (!cam) return -1;
-    struct v4l2_control ctrl = {0};
-    switch(param) {
-        case WEBCAM_PARAM_EXPOSURE:
-            ctrl.id = V4L2_CID_EXPOSURE_AUTO;
-            ctrl.value = is_auto ? V4L2_EXPOSURE_AUTO : V4L2_EXPOSURE_MANUAL;
-            break;
-        case WEBCAM_PARAM_FOCUS:
-            ctrl.id = V4L2_CID_FOCUS_AUTO;
-            ctrl.value = is_auto ? 1 : 0;
-            break;
-        default:
-            return -1;
-    }
-    return (ioctl(cam->fd, VIDIOC_S_CTRL, &ctrl) == 0) ? 0 : -1;
-}
-
 #endif // __linux__
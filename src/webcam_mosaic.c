@@ -0,0 +1,332 @@
+// ============================================================================
+// webcam_mosaic.c - Multi-camera tiled compositor
+// ============================================================================
+// Each camera owns one cell of a grid; its frames are letterboxed into the
+// cell, scaled and converted straight from the native format into the shared
+// output buffer. Only tiles that received a new frame are redrawn. Per tile
+// row, the two source rows are sampled horizontally into 8.8 planes (cached
+// while the rows repeat), then blended vertically and converted to RGB eight
+// pixels at a time (webcam_kernels.c). MJPEG is decoded at the smallest IDCT scale
+// that still covers the tile; Bayer goes through webcam_scale().
+// ============================================================================
+#include "webcam_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    Webcam *cam;                // NULL: fed through webcam_mosaic_update() only
+    int cell_x, cell_y;
+    int x, y, w, h;             // Image rectangle inside the cell (letterboxed)
+    int src_w, src_h;           // Frame geometry the rectangle was fitted to
+    int map_w;                  // Source width the column map was built for
+    int *x0, *x1;
+    unsigned char *fx;
+    unsigned char *scratch;     // Decoded MJPEG / scaled Bayer
+    size_t scratch_cap;
+} MosaicTile;
+
+struct WebcamMosaic {
+    int width, height;
+    int bpp;
+    WebcamPixelFormat format;
+    unsigned char *data;
+    uint64_t timestamp_us;      // Newest frame drawn
+    int cols, rows;
+    int cell_w, cell_h;
+    int count;
+    MosaicTile *tiles;
+    WebcamJpegDecoder *decoder; // Created on the first MJPEG frame
+};
+
+static int grow(unsigned char **buf, size_t *cap, size_t need) {
+    if (need <= *cap) return 0;
+    unsigned char *p = (unsigned char*)realloc(*buf, need);
+    if (!p) return -1;
+    *buf = p;
+    *cap = need;
+    return 0;
+}
+
+// Black (opaque) rectangle in the output
+static void fill_black(WebcamMosaic *m, int x, int y, int w, int h) {
+    for (int r = y; r < y + h; r++) {
+        unsigned char *p = m->data + ((size_t)r * m->width + x) * m->bpp;
+        if (m->bpp == 3) {
+            memset(p, 0, (size_t)w * 3);
+        } else {
+            for (int c = 0; c < w; c++, p += 4) { p[0] = p[1] = p[2] = 0; p[3] = 255; }
+        }
+    }
+}
+
+// Fit a src_w x src_h image in the tile's cell, clearing the cell when the
+// geometry changes
+static int tile_layout(WebcamMosaic *m, MosaicTile *t, int src_w, int src_h) {
+    if (t->src_w == src_w && t->src_h == src_h) return 0;
+
+    int w = m->cell_w, h = m->cell_h;
+    if ((long long)src_w * m->cell_h > (long long)src_h * m->cell_w)
+        h = (int)((long long)src_h * m->cell_w / src_w);
+    else
+        w = (int)((long long)src_w * m->cell_h / src_h);
+    if (w < 1) w = 1;
+    if (h < 1) h = 1;
+
+    int *x0 = (int*)realloc(t->x0, (size_t)w * sizeof(int));
+    if (x0) t->x0 = x0;
+    int *x1 = (int*)realloc(t->x1, (size_t)w * sizeof(int));
+    if (x1) t->x1 = x1;
+    unsigned char *fx = (unsigned char*)realloc(t->fx, (size_t)w);
+    if (fx) t->fx = fx;
+    if (!x0 || !x1 || !fx) {
+        t->src_w = 0;
+        return -1;
+    }
+
+    t->src_w = src_w;
+    t->src_h = src_h;
+    t->map_w = 0;
+    t->x = t->cell_x + (m->cell_w - w) / 2;
+    t->y = t->cell_y + (m->cell_h - h) / 2;
+    t->w = w;
+    t->h = h;
+    fill_black(m, t->cell_x, t->cell_y, m->cell_w, m->cell_h);
+    return 0;
+}
+
+// Output column -> source columns; src_w differs from the frame's for
+// reduced-size MJPEG decodes
+static void tile_map(MosaicTile *t, int src_w) {
+    if (t->map_w == src_w) return;
+    for (int c = 0; c < t->w; c++) {
+        int sx = webcam_src_coord(c, src_w, t->w);
+        t->x0[c] = sx >> 16;
+        t->x1[c] = t->x0[c] + 1 < src_w ? t->x0[c] + 1 : t->x0[c];
+        t->fx[c] = (unsigned char)((sx >> 8) & 255);
+    }
+    t->map_w = src_w;
+}
+
+// ---------------------------------------------------------------------------
+// Row kernel: vertical blend + color conversion + store
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    WebcamMosaic *m;
+    const MosaicTile *t;
+    const WebcamFrame *src;
+    int is_yuv;
+    int failed;
+} TileJob;
+
+// Channels of one output row, int16 planes for the row kernels
+typedef struct {
+    short c[3][MAX_ROW_WIDTH];
+} TileLine;
+
+static void tile_rows(void *ctx, int begin, int end) {
+    TileJob *job = (TileJob*)ctx;
+    WebcamMosaic *m = job->m;
+    const MosaicTile *t = job->t;
+    const int n = t->w, sh = job->src->height;
+
+    // Two cached source rows (3 planes each) and the output line
+    unsigned short *mem = (unsigned short*)malloc((size_t)6 * n * sizeof(unsigned short));
+    TileLine *line = (TileLine*)malloc(sizeof(TileLine));
+    if (!mem || !line) {
+        free(mem);
+        free(line);
+        job->failed = 1;
+        return;
+    }
+    short *const planes[3] = { line->c[0], line->c[1], line->c[2] };
+    unsigned short *rows[2][3];
+    for (int k = 0; k < 6; k++) rows[k / 3][k % 3] = mem + (size_t)k * n;
+    int cached[2] = { -1, -1 };
+
+    for (int r = begin; r < end; r++) {
+        int sy = webcam_src_coord(r, sh, t->h);
+        int y0 = sy >> 16;
+        int y1 = y0 + 1 < sh ? y0 + 1 : y0;
+        int fy = (sy >> 8) & 255;
+
+        if (cached[0] != y0) {
+            if (cached[1] == y0) {
+                unsigned short *tmp[3] = { rows[0][0], rows[0][1], rows[0][2] };
+                for (int k = 0; k < 3; k++) { rows[0][k] = rows[1][k]; rows[1][k] = tmp[k]; }
+                cached[1] = -1;
+            } else {
+                webcam_sample_row(job->src, y0, t->x0, t->x1, t->fx, n, rows[0]);
+            }
+            cached[0] = y0;
+        }
+        if (fy && cached[1] != y1) {
+            webcam_sample_row(job->src, y1, t->x0, t->x1, t->fx, n, rows[1]);
+            cached[1] = y1;
+        }
+
+        webcam_blend_rows(rows[0], rows[1], fy, n, planes);
+        if (job->is_yuv) webcam_yuv_to_rgb(planes, n);
+        webcam_pack_rgb(planes, n, m->data + ((size_t)(t->y + r) * m->width + t->x) * m->bpp, m->bpp);
+    }
+    free(mem);
+    free(line);
+}
+
+// Smallest decoder scale whose output still covers the tile
+static int jpeg_scale_for(const MosaicTile *t, const WebcamFrame *frame) {
+    for (int s = 8; s > 1; s /= 2)
+        if ((frame->width + s - 1) / s >= t->w && (frame->height + s - 1) / s >= t->h) return s;
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+WEBCAM_API WebcamMosaic* webcam_mosaic_create(Webcam **cams, int count, int width, int height,
+                                              int cols, WebcamPixelFormat format) {
+    if (count <= 0 || count > WEBCAM_MOSAIC_MAX_TILES) return NULL;
+    if (width <= 0 || height <= 0 || width > MAX_ROW_WIDTH) return NULL;
+    if (format != WEBCAM_FMT_RGB24 && format != WEBCAM_FMT_RGB32) return NULL;
+
+    if (cols <= 0) {
+        cols = 1;
+        while (cols * cols < count) cols++;
+    }
+    if (cols > count) cols = count;
+    int rows = (count + cols - 1) / cols;
+    if (width / cols < 1 || height / rows < 1) return NULL;
+
+    WebcamMosaic *m = (WebcamMosaic*)calloc(1, sizeof(WebcamMosaic));
+    if (!m) return NULL;
+    m->tiles = (MosaicTile*)calloc(count, sizeof(MosaicTile));
+    m->data = (unsigned char*)malloc(webcam_frame_size(format, width, height));
+    if (!m->tiles || !m->data) {
+        free(m->tiles);
+        free(m->data);
+        free(m);
+        return NULL;
+    }
+
+    m->width = width;
+    m->height = height;
+    m->format = format;
+    m->bpp = format == WEBCAM_FMT_RGB24 ? 3 : 4;
+    m->cols = cols;
+    m->rows = rows;
+    m->cell_w = width / cols;
+    m->cell_h = height / rows;
+    m->count = count;
+    for (int i = 0; i < count; i++) {
+        m->tiles[i].cam = cams ? cams[i] : NULL;
+        m->tiles[i].cell_x = (i % cols) * m->cell_w;
+        m->tiles[i].cell_y = (i / cols) * m->cell_h;
+    }
+    fill_black(m, 0, 0, width, height);
+    return m;
+}
+
+WEBCAM_API int webcam_mosaic_update(WebcamMosaic *m, int index, const WebcamFrame *frame) {
+    if (!m || index < 0 || index >= m->count || !frame || !frame->data) return -1;
+    // MJPEG too: the letterbox is fitted to the geometry the frame claims
+    if (frame->width <= 0 || frame->height <= 0) return -1;
+    MosaicTile *t = &m->tiles[index];
+    if (tile_layout(m, t, frame->width, frame->height) < 0) return -1;
+
+    WebcamWorkers *workers = webcam_get_workers(t->cam);
+    WebcamFrame decoded;
+    const WebcamFrame *src = frame;
+
+    if (frame->format == WEBCAM_FMT_MJPEG) {
+        if (!m->decoder) m->decoder = webcam_jpeg_decoder_create();
+        if (!m->decoder) return -1;
+        int scale = jpeg_scale_for(t, frame);
+        int dw = ((frame->width + scale - 1) / scale + 1) & ~1;
+        int dh = ((frame->height + scale - 1) / scale + 1) & ~1;
+        if (grow(&t->scratch, &t->scratch_cap, webcam_frame_size(WEBCAM_FMT_YUV420, dw, dh)) < 0)
+            return -1;
+        if (webcam_jpeg_decode(m->decoder, frame, scale, WEBCAM_FMT_YUV420,
+                               t->scratch, t->scratch_cap, &decoded) != 0) return -1;
+        src = &decoded;
+    } else if (!webcam_frame_valid(frame)) {
+        return -1;
+    } else if (webcam_is_bayer(frame->format)) {
+        // Scale to the tile size, then copy it into place
+        if (grow(&t->scratch, &t->scratch_cap, webcam_frame_size(m->format, t->w, t->h)) < 0 ||
+            webcam_scale(t->cam, frame, t->scratch, t->w, t->h, m->format) != 0) return -1;
+        const size_t row = (size_t)t->w * m->bpp;
+        for (int r = 0; r < t->h; r++)
+            memcpy(m->data + ((size_t)(t->y + r) * m->width + t->x) * m->bpp,
+                   t->scratch + r * row, row);
+        if (frame->timestamp_us > m->timestamp_us) m->timestamp_us = frame->timestamp_us;
+        return 0;
+    }
+
+    tile_map(t, src->width);
+
+    TileJob job;
+    job.m = m;
+    job.t = t;
+    job.src = src;
+    job.is_yuv = src->format == WEBCAM_FMT_YUYV || src->format == WEBCAM_FMT_YUV420 ||
+                 src->format == WEBCAM_FMT_NV12;
+    job.failed = 0;
+    webcam_parallel_rows(workers, t->h, tile_rows, &job);
+    if (job.failed) return -1;
+
+    if (frame->timestamp_us > m->timestamp_us) m->timestamp_us = frame->timestamp_us;
+    return 0;
+}
+
+WEBCAM_API int webcam_mosaic_render(WebcamMosaic *m) {
+    if (!m) return -1;
+
+    int updated = 0;
+    for (int i = 0; i < m->count; i++) {
+        Webcam *cam = m->tiles[i].cam;
+        if (!cam) continue;
+
+        // Keep only the newest ready frame. Without a pollable fd (Windows)
+        // capture is synchronous, so take a single frame.
+        WebcamFrame latest, frame;
+        int have = 0;
+        while (webcam_try_capture(cam, &frame) == 0) {
+            if (have) webcam_return_frame(cam, &latest);
+            latest = frame;
+            have = 1;
+            if (webcam_get_fd(cam) < 0) break;
+        }
+        if (!have) continue;
+
+        if (webcam_mosaic_update(m, i, &latest) == 0) updated++;
+        webcam_return_frame(cam, &latest);
+    }
+    return updated;
+}
+
+WEBCAM_API int webcam_mosaic_get_frame(WebcamMosaic *m, WebcamFrame *out) {
+    if (!m || !out) return -1;
+    memset(out, 0, sizeof(*out));
+    out->data = m->data;
+    out->width = m->width;
+    out->height = m->height;
+    out->format = m->format;
+    out->size = (int)webcam_frame_size(m->format, m->width, m->height);
+    out->timestamp_us = m->timestamp_us;
+    return 0;
+}
+
+WEBCAM_API void webcam_mosaic_destroy(WebcamMosaic *m) {
+    if (!m) return;
+    for (int i = 0; i < m->count; i++) {
+        free(m->tiles[i].x0);
+        free(m->tiles[i].x1);
+        free(m->tiles[i].fx);
+        free(m->tiles[i].scratch);
+    }
+    if (m->decoder) webcam_jpeg_decoder_destroy(m->decoder);
+    free(m->tiles);
+    free(m->data);
+    free(m);
+}
@@ -0,0 +1,343 @@
+// ============================================================================
+// webcam_orient.c - Rotate, flip and transpose in the native pixel format
+// ============================================================================
+// Every operation is expressed as "output (r, c) reads source (row, col)",
+// optionally with rows and columns swapped. Row-preserving operations (flips,
+// 180) copy or reverse whole rows. Transposing operations (90, 270, transpose)
+// walk the output in 32x32 tiles so both the source rows and the output
+// columns of a tile stay in L1; on x86 the tile is further split into 8x8
+// (4x4 for 32-bit pixels) blocks transposed inside SSE2 registers.
+// Planar formats are processed plane by plane with the same operation.
+// ============================================================================
+#include "webcam_internal.h"
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define ORIENT_SSE2 1
+#endif
+
+#define TILE 32
+
+// Output -> source mapping. Without swap: src(fy ? H-1-r : r, fx ? W-1-c : c).
+// With swap:                              src(fy ? H-1-c : c, fx ? W-1-r : r).
+typedef struct { int swap, fx, fy; } OrientMap;
+
+static const OrientMap orient_maps[] = {
+    { 0, 0, 0 },    // WEBCAM_ROTATE_0
+    { 1, 0, 1 },    // WEBCAM_ROTATE_90
+    { 0, 1, 1 },    // WEBCAM_ROTATE_180
+    { 1, 1, 0 },    // WEBCAM_ROTATE_270
+    { 0, 1, 0 },    // WEBCAM_FLIP_H
+    { 0, 0, 1 },    // WEBCAM_FLIP_V
+    { 1, 0, 0 },    // WEBCAM_TRANSPOSE
+};
+
+typedef struct {
+    const unsigned char *src;
+    int src_w, src_h;           // In elements
+    size_t src_stride;
+    unsigned char *dst;
+    int dst_w, dst_h;
+    size_t dst_stride;
+    int elem;                   // Bytes per element: 1, 2, 3 or 4
+    OrientMap m;
+} PlaneJob;
+
+// ---------------------------------------------------------------------------
+// Row-preserving operations
+// ---------------------------------------------------------------------------
+
+static void reverse_row(const unsigned char *s, unsigned char *d, int n, int elem) {
+    s += (size_t)(n - 1) * elem;
+    switch (elem) {
+        case 1: for (int i = 0; i < n; i++, s--)     d[i] = s[0]; break;
+        case 2: for (int i = 0; i < n; i++, s -= 2, d += 2) memcpy(d, s, 2); break;
+        case 3: for (int i = 0; i < n; i++, s -= 3, d += 3) memcpy(d, s, 3); break;
+        case 4: for (int i = 0; i < n; i++, s -= 4, d += 4) memcpy(d, s, 4); break;
+    }
+}
+
+static void flip_rows(void *ctx, int begin, int end) {
+    const PlaneJob *job = (const PlaneJob*)ctx;
+    for (int r = begin; r < end; r++) {
+        const unsigned char *s = job->src + (size_t)(job->m.fy ? job->src_h - 1 - r : r) * job->src_stride;
+        unsigned char *d = job->dst + (size_t)r * job->dst_stride;
+        if (job->m.fx) reverse_row(s, d, job->src_w, job->elem);
+        else memcpy(d, s, (size_t)job->src_w * job->elem);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Transposing operations
+// ---------------------------------------------------------------------------
+
+#ifdef ORIENT_SSE2
+// out[k][j] = in[j][k] for an 8x8 block of bytes
+static void transpose_8x8_u8(const unsigned char *const p[8], unsigned char *const q[8]) {
+    __m128i b0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p[0]), _mm_loadl_epi64((const __m128i*)p[1]));
+    __m128i b1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p[2]), _mm_loadl_epi64((const __m128i*)p[3]));
+    __m128i b2 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p[4]), _mm_loadl_epi64((const __m128i*)p[5]));
+    __m128i b3 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p[6]), _mm_loadl_epi64((const __m128i*)p[7]));
+    __m128i c0 = _mm_unpacklo_epi16(b0, b1), c1 = _mm_unpackhi_epi16(b0, b1);
+    __m128i c2 = _mm_unpacklo_epi16(b2, b3), c3 = _mm_unpackhi_epi16(b2, b3);
+    __m128i d0 = _mm_unpacklo_epi32(c0, c2), d1 = _mm_unpackhi_epi32(c0, c2);
+    __m128i d2 = _mm_unpacklo_epi32(c1, c3), d3 = _mm_unpackhi_epi32(c1, c3);
+    _mm_storel_epi64((__m128i*)q[0], d0); _mm_storel_epi64((__m128i*)q[1], _mm_srli_si128(d0, 8));
+    _mm_storel_epi64((__m128i*)q[2], d1); _mm_storel_epi64((__m128i*)q[3], _mm_srli_si128(d1, 8));
+    _mm_storel_epi64((__m128i*)q[4], d2); _mm_storel_epi64((__m128i*)q[5], _mm_srli_si128(d2, 8));
+    _mm_storel_epi64((__m128i*)q[6], d3); _mm_storel_epi64((__m128i*)q[7], _mm_srli_si128(d3, 8));
+}
+
+// Same for 8x8 16-bit elements (NV12 chroma pairs)
+static void transpose_8x8_u16(const unsigned char *const p[8], unsigned char *const q[8]) {
+    __m128i a[8];
+    for (int j = 0; j < 8; j++) a[j] = _mm_loadu_si128((const __m128i*)p[j]);
+    __m128i b0 = _mm_unpacklo_epi16(a[0], a[1]), b1 = _mm_unpackhi_epi16(a[0], a[1]);
+    __m128i b2 = _mm_unpacklo_epi16(a[2], a[3]), b3 = _mm_unpackhi_epi16(a[2], a[3]);
+    __m128i b4 = _mm_unpacklo_epi16(a[4], a[5]), b5 = _mm_unpackhi_epi16(a[4], a[5]);
+    __m128i b6 = _mm_unpacklo_epi16(a[6], a[7]), b7 = _mm_unpackhi_epi16(a[6], a[7]);
+    __m128i c0 = _mm_unpacklo_epi32(b0, b2), c1 = _mm_unpackhi_epi32(b0, b2);
+    __m128i c2 = _mm_unpacklo_epi32(b1, b3), c3 = _mm_unpackhi_epi32(b1, b3);
+    __m128i c4 = _mm_unpacklo_epi32(b4, b6), c5 = _mm_unpackhi_epi32(b4, b6);
+    __m128i c6 = _mm_unpacklo_epi32(b5, b7), c7 = _mm_unpackhi_epi32(b5, b7);
+    _mm_storeu_si128((__m128i*)q[0], _mm_unpacklo_epi64(c0, c4));
+    _mm_storeu_si128((__m128i*)q[1], _mm_unpackhi_epi64(c0, c4));
+    _mm_storeu_si128((__m128i*)q[2], _mm_unpacklo_epi64(c1, c5));
+    _mm_storeu_si128((__m128i*)q[3], _mm_unpackhi_epi64(c1, c5));
+    _mm_storeu_si128((__m128i*)q[4], _mm_unpacklo_epi64(c2, c6));
+    _mm_storeu_si128((__m128i*)q[5], _mm_unpackhi_epi64(c2, c6));
+    _mm_storeu_si128((__m128i*)q[6], _mm_unpacklo_epi64(c3, c7));
+    _mm_storeu_si128((__m128i*)q[7], _mm_unpackhi_epi64(c3, c7));
+}
+
+// Same for 4x4 32-bit elements (RGB32)
+static void transpose_4x4_u32(const unsigned char *const p[8], unsigned char *const q[8]) {
+    __m128i a0 = _mm_loadu_si128((const __m128i*)p[0]), a1 = _mm_loadu_si128((const __m128i*)p[1]);
+    __m128i a2 = _mm_loadu_si128((const __m128i*)p[2]), a3 = _mm_loadu_si128((const __m128i*)p[3]);
+    __m128i b0 = _mm_unpacklo_epi32(a0, a1), b1 = _mm_unpackhi_epi32(a0, a1);
+    __m128i b2 = _mm_unpacklo_epi32(a2, a3), b3 = _mm_unpackhi_epi32(a2, a3);
+    _mm_storeu_si128((__m128i*)q[0], _mm_unpacklo_epi64(b0, b2));
+    _mm_storeu_si128((__m128i*)q[1], _mm_unpackhi_epi64(b0, b2));
+    _mm_storeu_si128((__m128i*)q[2], _mm_unpacklo_epi64(b1, b3));
+    _mm_storeu_si128((__m128i*)q[3], _mm_unpackhi_epi64(b1, b3));
+}
+#endif
+
+static int src_row(const PlaneJob *job, int c) { return job->m.fy ? job->src_h - 1 - c : c; }
+static int src_col(const PlaneJob *job, int r) { return job->m.fx ? job->src_w - 1 - r : r; }
+
+// Output rows [r0, r1) x columns [c0, c1), one element at a time
+static void transpose_scalar(const PlaneJob *job, int r0, int r1, int c0, int c1) {
+    const int elem = job->elem;
+    for (int c = c0; c < c1; c++) {
+        const unsigned char *s = job->src + (size_t)src_row(job, c) * job->src_stride;
+        unsigned char *d = job->dst + (size_t)c * elem;
+        for (int r = r0; r < r1; r++)
+            memcpy(d + (size_t)r * job->dst_stride, s + (size_t)src_col(job, r) * elem, elem);
+    }
+}
+
+// Tile rows [begin, end): each covers TILE output rows
+static void transpose_tiles(void *ctx, int begin, int end) {
+    const PlaneJob *job = (const PlaneJob*)ctx;
+    const int elem = job->elem;
+    int block = 0;
+#ifdef ORIENT_SSE2
+    if (elem == 1 || elem == 2) block = 8;
+    else if (elem == 4) block = 4;
+#endif
+
+    for (int t = begin; t < end; t++) {
+        int r0 = t * TILE;
+        int r1 = r0 + TILE < job->dst_h ? r0 + TILE : job->dst_h;
+
+        for (int c0 = 0; c0 < job->dst_w; c0 += TILE) {
+            int c1 = c0 + TILE < job->dst_w ? c0 + TILE : job->dst_w;
+            if (!block) {
+                transpose_scalar(job, r0, r1, c0, c1);
+                continue;
+            }
+#ifdef ORIENT_SSE2
+            int rb = r0 + (r1 - r0) / block * block;
+            int cb = c0 + (c1 - c0) / block * block;
+            for (int r = r0; r < rb; r += block) {
+                // Lowest source column of the block; with fx the output rows run backwards
+                int x = job->m.fx ? src_col(job, r + block - 1) : r;
+                for (int c = c0; c < cb; c += block) {
+                    const unsigned char *p[8];
+                    unsigned char *q[8];
+                    for (int j = 0; j < block; j++) {
+                        p[j] = job->src + (size_t)src_row(job, c + j) * job->src_stride + (size_t)x * elem;
+                        int rr = job->m.fx ? r + block - 1 - j : r + j;
+                        q[j] = job->dst + (size_t)rr * job->dst_stride + (size_t)c * elem;
+                    }
+                    if (elem == 1) transpose_8x8_u8(p, q);
+                    else if (elem == 2) transpose_8x8_u16(p, q);
+                    else transpose_4x4_u32(p, q);
+                }
+            }
+            transpose_scalar(job, r0, rb, cb, c1);
+            transpose_scalar(job, rb, r1, c0, c1);
+#endif
+        }
+    }
+}
+
+static void orient_plane(Webcam *cam, const unsigned char *src, int w, int h, int elem,
+                         unsigned char *dst, OrientMap m) {
+    PlaneJob job;
+    job.src = src;
+    job.src_w = w;
+    job.src_h = h;
+    job.src_stride = (size_t)w * elem;
+    job.dst = dst;
+    job.dst_w = m.swap ? h : w;
+    job.dst_h = m.swap ? w : h;
+    job.dst_stride = (size_t)job.dst_w * elem;
+    job.elem = elem;
+    job.m = m;
+
+    if (m.swap)
+        webcam_parallel_rows(webcam_get_workers(cam), (job.dst_h + TILE - 1) / TILE, transpose_tiles, &job);
+    else
+        webcam_parallel_rows(webcam_get_workers(cam), job.dst_h, flip_rows, &job);
+}
+
+// ---------------------------------------------------------------------------
+// YUYV: pixel pairs share chroma, so it is not a plain array of elements
+// ---------------------------------------------------------------------------
+
+static void yuyv_flip_rows(void *ctx, int begin, int end) {
+    const PlaneJob *job = (const PlaneJob*)ctx;
+    const int pairs = job->src_w / 2;
+    for (int r = begin; r < end; r++) {
+        const unsigned char *s = job->src + (size_t)(job->m.fy ? job->src_h - 1 - r : r) * job->src_stride;
+        unsigned char *d = job->dst + (size_t)r * job->dst_stride;
+        if (!job->m.fx) {
+            memcpy(d, s, job->src_stride);
+            continue;
+        }
+        // Mirror pair order and swap the two lumas of each pair
+        for (int i = 0; i < pairs; i++, d += 4) {
+            const unsigned char *p = s + (size_t)(pairs - 1 - i) * 4;
+            d[0] = p[2]; d[1] = p[1]; d[2] = p[0]; d[3] = p[3];
+        }
+    }
+}
+
+// Each output pair comes from two source rows; its chroma is their average
+static void yuyv_transpose_tiles(void *ctx, int begin, int end) {
+    const PlaneJob *job = (const PlaneJob*)ctx;
+    for (int t = begin; t < end; t++) {
+        int r0 = t * TILE;
+        int r1 = r0 + TILE < job->dst_h ? r0 + TILE : job->dst_h;
+
+        for (int c0 = 0; c0 < job->dst_w; c0 += TILE) {
+            int c1 = c0 + TILE < job->dst_w ? c0 + TILE : job->dst_w;
+            for (int c = c0; c < c1; c += 2) {
+                const unsigned char *sa = job->src + (size_t)src_row(job, c) * job->src_stride;
+                const unsigned char *sb = job->src + (size_t)src_row(job, c + 1) * job->src_stride;
+                unsigned char *d = job->dst + (size_t)c * 2;
+                for (int r = r0; r < r1; r++) {
+                    int x = src_col(job, r);
+                    const unsigned char *a = sa + (x >> 1) * 4, *b = sb + (x >> 1) * 4;
+                    unsigned char *o = d + (size_t)r * job->dst_stride;
+                    o[0] = a[(x & 1) * 2];
+                    o[1] = (unsigned char)((a[1] + b[1] + 1) >> 1);
+                    o[2] = b[(x & 1) * 2];
+                    o[3] = (unsigned char)((a[3] + b[3] + 1) >> 1);
+                }
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+// ---------------------------------------------------------------------------
+
+WEBCAM_API int webcam_orient(Webcam *cam, const WebcamFrame *src, WebcamOrientation op,
+                             unsigned char *dst, WebcamFrame *out) {
+    if (!webcam_frame_valid(src) || !dst || (unsigned)op > WEBCAM_TRANSPOSE) return -1;
+
+    const OrientMap m = orient_maps[op];
+    const int W = src->width, H = src->height;
+    const int dw = m.swap ? H : W, dh = m.swap ? W : H;
+
+    switch (src->format) {
+        case WEBCAM_FMT_GRAY8:
+            orient_plane(cam, src->data, W, H, 1, dst, m);
+            break;
+        case WEBCAM_FMT_RGB24:
+            orient_plane(cam, src->data, W, H, 3, dst, m);
+            break;
+        case WEBCAM_FMT_RGB32:
+            orient_plane(cam, src->data, W, H, 4, dst, m);
+            break;
+        case WEBCAM_FMT_YUV420:
+        case WEBCAM_FMT_NV12: {
+            if ((W | H) & 1) return -1;
+            const size_t luma = (size_t)W * H;
+            orient_plane(cam, src->data, W, H, 1, dst, m);
+            if (src->format == WEBCAM_FMT_NV12) {
+                orient_plane(cam, src->data + luma, W / 2, H / 2, 2, dst + luma, m);
+            } else {
+                const size_t chroma = luma / 4;
+                orient_plane(cam, src->data + luma, W / 2, H / 2, 1, dst + luma, m);
+                orient_plane(cam, src->data + luma + chroma, W / 2, H / 2, 1,
+                             dst + luma + chroma, m);
+            }
+            break;
+        }
+        case WEBCAM_FMT_YUYV: {
+            if (dw & 1) return -1;
+            PlaneJob job;
+            memset(&job, 0, sizeof(job));
+            job.src = src->data;
+            job.src_w = W;
+            job.src_h = H;
+            job.src_stride = (size_t)W * 2;
+            job.dst = dst;
+            job.dst_w = dw;
+            job.dst_h = dh;
+            job.dst_stride = (size_t)dw * 2;
+            job.m = m;
+            if (m.swap)
+                webcam_parallel_rows(webcam_get_workers(cam), (dh + TILE - 1) / TILE,
+                                     yuyv_transpose_tiles, &job);
+            else
+                webcam_parallel_rows(webcam_get_workers(cam), dh, yuyv_flip_rows, &job);
+            break;
+        }
+        default:
+            return -1;
+    }
+
+    if (out) {
+        *out = *src;
+        out->data = dst;
+        out->width = dw;
+        out->height = dh;
+        out->size = webcam_frame_size(src->format, dw, dh);
+    }
+    return 0;
+}
+
+WEBCAM_API WebcamOrientation webcam_set_orientation(Webcam *cam, WebcamOrientation op) {
+    if (!cam || (unsigned)op > WEBCAM_TRANSPOSE) return op;
+
+    // Only row-preserving operations map onto sensor mirroring; 90/270 would
+    // still need a full software transpose, so they gain nothing from it
+    const OrientMap m = orient_maps[op];
+    int want_h = !m.swap && m.fx, want_v = !m.swap && m.fy;
+    int got_h = webcam_set_parameter(cam, WEBCAM_PARAM_HFLIP, want_h) == 0 && want_h;
+    int got_v = webcam_set_parameter(cam, WEBCAM_PARAM_VFLIP, want_v) == 0 && want_v;
+
+    if (m.swap) return op;
+    int left_h = m.fx && !got_h, left_v = m.fy && !got_v;
+    if (left_h && left_v) return WEBCAM_ROTATE_180;
+    if (left_h) return WEBCAM_FLIP_H;
+    if (left_v) return WEBCAM_FLIP_V;
+    return WEBCAM_ROTATE_0;
+}
@@ -0,0 +1,203 @@
+// ============================================================================
+// webcam_pool.c - Fixed pool of aligned output buffers
+// ============================================================================
+// All buffers live in one region allocated up front (optionally huge pages and
+// pre-faulted). The free list is a Treiber stack of buffer indices; the head
+// carries a 32-bit tag next to the index so a stale CAS cannot succeed (ABA).
+// acquire/release never touch the heap and never take a lock.
+// ============================================================================
+#include "webcam.h"
+#include "webcam_atomic.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <sys/mman.h>
+#endif
+
+#define POOL_ALIGN 64
+#define POOL_EMPTY 0xFFFFFFFFu
+
+struct WebcamFramePool {
+    unsigned char *base;
+    size_t region_size;
+    size_t stride;
+    size_t buffer_size;
+    int count;
+    int hugepages;
+    int locked;
+    atomic_int32 *next;         // Free-list links, indexed by buffer
+    volatile int64_t head;      // (tag << 32) | index
+    volatile atomic_int32 in_use;
+    volatile int64_t acquired;
+    volatile int64_t exhausted;
+};
+
+static int64_t pack_head(uint32_t tag, uint32_t index) {
+    return (int64_t)(((uint64_t)tag << 32) | index);
+}
+
+static uint32_t head_index(int64_t head) { return (uint32_t)((uint64_t)head & 0xFFFFFFFFu); }
+static uint32_t head_tag(int64_t head) { return (uint32_t)((uint64_t)head >> 32); }
+
+static int pool_map(WebcamFramePool *pool, int flags) {
+    size_t size = pool->region_size;
+#if defined(_WIN32)
+    if (flags & WEBCAM_POOL_HUGEPAGES) {
+        SIZE_T large = GetLargePageMinimum();
+        if (large) {
+            size_t rounded = (size + large - 1) / large * large;
+            void *p = VirtualAlloc(NULL, rounded,
+                                   MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                                   PAGE_READWRITE);
+            if (p) {
+                pool->base = (unsigned char*)p;
+                pool->region_size = rounded;
+                pool->hugepages = 1;
+                return 0;
+            }
+        }
+    }
+    void *p = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!p) return -1;
+    pool->base = (unsigned char*)p;
+    if (flags & WEBCAM_POOL_POPULATE) memset(p, 0, size);
+    return 0;
+#else
+    int mflags = MAP_PRIVATE | MAP_ANONYMOUS;
+  #ifdef MAP_POPULATE
+    if (flags & WEBCAM_POOL_POPULATE) mflags |= MAP_POPULATE;
+  #endif
+  #ifdef MAP_HUGETLB
+    if (flags & WEBCAM_POOL_HUGEPAGES) {
+        size_t huge = 2u * 1024 * 1024;
+        size_t rounded = (size + huge - 1) / huge * huge;
+        void *p = mmap(NULL, rounded, PROT_READ | PROT_WRITE, mflags | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            pool->base = p;
+            pool->region_size = rounded;
+            pool->hugepages = 1;
+            return 0;
+        }
+    }
+  #endif
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, mflags, -1, 0);
+    if (p == MAP_FAILED) return -1;
+  #ifdef MADV_HUGEPAGE
+    // No reserved huge pages: let transparent huge pages back the region instead
+    if (flags & WEBCAM_POOL_HUGEPAGES) madvise(p, size, MADV_HUGEPAGE);
+  #endif
+    pool->base = p;
+    return 0;
+#endif
+}
+
+static void pool_unmap(WebcamFramePool *pool) {
+    if (!pool->base) return;
+#if defined(_WIN32)
+    VirtualFree(pool->base, 0, MEM_RELEASE);
+#else
+    munmap(pool->base, pool->region_size);
+#endif
+}
+
+WEBCAM_API WebcamFramePool* webcam_pool_create(size_t buffer_size, int count, int flags) {
+    if (buffer_size == 0 || count <= 0) return NULL;
+
+    WebcamFramePool *pool = (WebcamFramePool*)calloc(1, sizeof(WebcamFramePool));
+    if (!pool) return NULL;
+
+    pool->buffer_size = buffer_size;
+    pool->stride = (buffer_size + POOL_ALIGN - 1) / POOL_ALIGN * POOL_ALIGN;
+    pool->count = count;
+    pool->region_size = pool->stride * (size_t)count;
+    pool->next = (atomic_int32*)malloc(count * sizeof(atomic_int32));
+
+    if (!pool->next || pool_map(pool, flags) != 0) {
+        free(pool->next);
+        free(pool);
+        return NULL;
+    }
+
+    // Locking faults every page in as well; best effort, see stats.locked
+    if (flags & WEBCAM_POOL_LOCK) {
+#if defined(_WIN32)
+        pool->locked = VirtualLock(pool->base, pool->region_size) != 0;
+#else
+        pool->locked = mlock(pool->base, pool->region_size) == 0;
+#endif
+    }
+
+    for (int i = 0; i < count; i++)
+        pool->next[i] = (i + 1 < count) ? i + 1 : -1;
+    pool->head = pack_head(0, 0);
+    return pool;
+}
+
+WEBCAM_API WebcamFramePool* webcam_pool_create_for(Webcam *cam, WebcamPixelFormat format,
+                                                   int count, int flags) {
+    if (!cam) return NULL;
+    size_t size = webcam_frame_size(format, webcam_get_actual_width(cam),
+                                    webcam_get_actual_height(cam));
+    return webcam_pool_create(size, count, flags);
+}
+
+WEBCAM_API unsigned char* webcam_pool_acquire(WebcamFramePool *pool) {
+    if (!pool) return NULL;
+
+    int64_t head = atomic_load_64(&pool->head);
+    for (;;) {
+        uint32_t index = head_index(head);
+        if (index == POOL_EMPTY) {
+            atomic_add_64(&pool->exhausted, 1);
+            return NULL;
+        }
+        int64_t next = pack_head(head_tag(head) + 1,
+                                 (uint32_t)atomic_relaxed_load_32(&pool->next[index]));
+        if (atomic_cas_64(&pool->head, &head, next)) {
+            atomic_add_32(&pool->in_use, 1);
+            atomic_add_64(&pool->acquired, 1);
+            return pool->base + (size_t)index * pool->stride;
+        }
+    }
+}
+
+WEBCAM_API void webcam_pool_release(WebcamFramePool *pool, unsigned char *buffer) {
+    if (!pool || !buffer || buffer < pool->base) return;
+
+    size_t offset = (size_t)(buffer - pool->base);
+    if (offset % pool->stride != 0 || offset / pool->stride >= (size_t)pool->count) return;
+    uint32_t index = (uint32_t)(offset / pool->stride);
+
+    int64_t head = atomic_load_64(&pool->head);
+    for (;;) {
+        atomic_relaxed_store_32(&pool->next[index], (atomic_int32)head_index(head));
+        int64_t next = pack_head(head_tag(head) + 1, index);
+        if (atomic_cas_64(&pool->head, &head, next)) break;
+    }
+    atomic_add_32(&pool->in_use, -1);
+}
+
+WEBCAM_API size_t webcam_pool_buffer_size(WebcamFramePool *pool) {
+    return pool ? pool->buffer_size : 0;
+}
+
+WEBCAM_API void webcam_pool_get_stats(WebcamFramePool *pool, WebcamPoolStats *stats) {
+    if (!pool || !stats) return;
+    stats->buffer_count = pool->count;
+    stats->in_use = (int)atomic_add_32(&pool->in_use, 0);
+    stats->buffer_size = pool->buffer_size;
+    stats->hugepages = pool->hugepages;
+    stats->locked = pool->locked;
+    stats->acquired = (unsigned long)atomic_load_64(&pool->acquired);
+    stats->exhausted = (unsigned long)atomic_load_64(&pool->exhausted);
+}
+
+WEBCAM_API void webcam_pool_destroy(WebcamFramePool *pool) {
+    if (!pool) return;
+    pool_unmap(pool);
+    free(pool->next);
+    free(pool);
+}
@@ -0,0 +1,167 @@
+// ============================================================================
+// webcam_rt.c - Real-time thread profile and wakeup latency histogram
+// ============================================================================
+// A profile pins a thread to CPUs and raises it to SCHED_FIFO (time-critical
+// priority on Windows). It is applied by the thread to itself, so worker pools
+// only need to forward it. Latency is kept in quarter-octave buckets, which
+// bound the reported percentile within ~19% at constant memory and cost.
+// ============================================================================
+#ifdef __linux__
+  #define _GNU_SOURCE
+#endif
+#include "webcam_internal.h"
+#include <string.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+// CPU index of the n-th set bit of mask, wrapping
+static int nth_cpu(uint64_t mask, int n) {
+    int count = 0;
+    for (int i = 0; i < 64; i++) count += (int)((mask >> i) & 1);
+    n %= count;
+    for (int i = 0; i < 64; i++)
+        if (((mask >> i) & 1) && n-- == 0) return i;
+    return 0;
+}
+
+int webcam_rt_apply_self(const WebcamRtProfile *profile, int slot) {
+    int r = 0;
+#if defined(_WIN32)
+    if (profile->cpu_mask) {
+        DWORD_PTR mask = slot < 0 ? (DWORD_PTR)profile->cpu_mask
+                                  : (DWORD_PTR)1 << nth_cpu(profile->cpu_mask, slot);
+        if (!SetThreadAffinityMask(GetCurrentThread(), mask)) r = -1;
+    }
+    if (profile->priority) {
+        int level = profile->priority > 0 ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_NORMAL;
+        if (!SetThreadPriority(GetCurrentThread(), level)) r = -1;
+    }
+#else
+  #ifdef __linux__
+    if (profile->cpu_mask) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (slot < 0) {
+            for (int i = 0; i < 64 && i < CPU_SETSIZE; i++)
+                if ((profile->cpu_mask >> i) & 1) CPU_SET(i, &set);
+        } else {
+            CPU_SET(nth_cpu(profile->cpu_mask, slot), &set);
+        }
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) r = -1;
+    }
+  #else
+    if (profile->cpu_mask) r = -1;  // No portable affinity call
+  #endif
+    if (profile->priority) {
+        struct sched_param sp;
+        memset(&sp, 0, sizeof(sp));
+        int policy = SCHED_OTHER;
+        if (profile->priority > 0) {
+            int lo = sched_get_priority_min(SCHED_FIFO), hi = sched_get_priority_max(SCHED_FIFO);
+            policy = SCHED_FIFO;
+            sp.sched_priority = profile->priority < lo ? lo :
+                                profile->priority > hi ? hi : profile->priority;
+        }
+        if (pthread_setschedparam(pthread_self(), policy, &sp) != 0) r = -1;
+    }
+#endif
+    return r;
+}
+
+WEBCAM_API int webcam_set_thread_rt(const WebcamRtProfile *profile) {
+    return profile ? webcam_rt_apply_self(profile, -1) : -1;
+}
+
+// 0-3 exact, then four buckets per power of two
+static int latency_bucket(uint64_t us) {
+    if (us < 4) return (int)us;
+    int e = 63;
+    while (!((us >> e) & 1)) e--;
+    if (e > 31) return WEBCAM_LATENCY_BUCKETS - 1;
+    return 4 * (e - 1) + (int)((us >> (e - 2)) & 3);
+}
+
+static uint64_t bucket_upper(int b) {
+    if (b < 4) return (uint64_t)b;
+    int e = b / 4 + 1, m = b % 4;
+    return ((uint64_t)(5 + m) << (e - 2)) - 1;
+}
+
+void webcam_latency_record(WebcamLatency *l, uint64_t us, int start_of_exposure) {
+    atomic_int32 seq = atomic_relaxed_load_32(&l->seq);
+    atomic_relaxed_store_32(&l->seq, seq + 1);
+    atomic_fence();
+
+    // The writer clears, so a reset never races an update
+    if (atomic_exchange_32(&l->reset, 0)) {
+        l->samples = 0;
+        l->min_us = l->max_us = l->sum_us = 0;
+        memset(l->buckets, 0, sizeof(l->buckets));
+    }
+    if (!l->samples || us < l->min_us) l->min_us = us;
+    if (us > l->max_us) l->max_us = us;
+    l->sum_us += us;
+    l->buckets[latency_bucket(us)]++;
+    l->samples++;
+    l->start_of_exposure = start_of_exposure;
+
+    atomic_fence();
+    atomic_relaxed_store_32(&l->seq, seq + 2);
+}
+
+static void yield_cpu(void) {
+#if defined(_WIN32)
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+// Seqlock read: copy, then retry if the writer was inside meanwhile (64-bit
+// figures may tear on 32-bit targets, the retry covers that too)
+void webcam_latency_read(WebcamLatency *l, WebcamLatencyStats *stats, int reset) {
+    const volatile WebcamLatency *v = l;
+    unsigned long buckets[WEBCAM_LATENCY_BUCKETS];
+    uint64_t sum_us;
+    memset(stats, 0, sizeof(*stats));
+    for (;;) {
+        atomic_int32 seq = atomic_load_32(&l->seq);
+        if (seq & 1) {
+            yield_cpu();    // The writer may be preempted mid-update
+            continue;
+        }
+        stats->samples = v->samples;
+        stats->min_us = v->min_us;
+        stats->max_us = v->max_us;
+        sum_us = v->sum_us;
+        stats->start_of_exposure = v->start_of_exposure;
+        for (int b = 0; b < WEBCAM_LATENCY_BUCKETS; b++) buckets[b] = v->buckets[b];
+        atomic_fence();
+        if (atomic_relaxed_load_32(&l->seq) == seq) break;
+        yield_cpu();
+    }
+    // A reset still pending reads as empty
+    if (atomic_load_32(&l->reset)) {
+        int soe = stats->start_of_exposure;
+        memset(stats, 0, sizeof(*stats));
+        stats->start_of_exposure = soe;
+    } else if (stats->samples) {
+        stats->mean_us = sum_us / stats->samples;
+        unsigned long rank = stats->samples - stats->samples / 100, seen = 0;
+        for (int b = 0; b < WEBCAM_LATENCY_BUCKETS; b++) {
+            seen += buckets[b];
+            if (seen >= rank) {
+                stats->p99_us = bucket_upper(b);
+                break;
+            }
+        }
+        if (stats->p99_us > stats->max_us) stats->p99_us = stats->max_us;
+        if (stats->p99_us < stats->min_us) stats->p99_us = stats->min_us;
+    }
+    if (reset) atomic_store_32(&l->reset, 1);
+}
@@ -0,0 +1,561 @@
+// ============================================================================
+// webcam_stream.c - MJPEG-over-HTTP server (multipart/x-mixed-replace)
+// ============================================================================
+// One epoll thread serves every viewer. Parts are sent with sendmsg() straight
+// from the mmap'd V4L2 buffer; the server holds at most the newest frame plus
+// the one being replaced. A viewer still writing a superseded frame gets the
+// unsent tail copied into its own spill buffer, so slow viewers never keep
+// camera buffers out of the driver queue. Raw frames are JPEG-encoded on
+// publish into a small ring of server-owned slots.
+// ============================================================================
+#ifdef __linux__
+
+#define _GNU_SOURCE
+#include "webcam_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+
+#define STREAM_BOUNDARY "webcamframe"
+#define STREAM_MAX_EVENTS 64
+#define STREAM_ENCODED_SLOTS 3
+#define STREAM_JPEG_QUALITY 80
+
+static const char STREAM_RESPONSE[] =
+    "HTTP/1.0 200 OK\r\n"
+    "Connection: close\r\n"
+    "Cache-Control: no-cache, no-store\r\n"
+    "Pragma: no-cache\r\n"
+    "Content-Type: multipart/x-mixed-replace; boundary=" STREAM_BOUNDARY "\r\n"
+    "\r\n";
+
+typedef struct {
+    int index;                  // V4L2 buffer index, -1 for encoded slots
+    const unsigned char *data;
+    size_t size;
+    unsigned long seq;
+    int refs;                   // Guarded by srv->lock
+    unsigned char *jpeg;        // Encoded slots: owned JPEG buffer
+    size_t jpeg_cap;
+} StreamSlot;
+
+typedef struct {
+    int fd;                     // -1 = free
+    int started;                // HTTP response already sent
+    int busy;                   // Part in flight
+    int want_out;               // EPOLLOUT registered
+    char head[256];
+    size_t head_len, head_off;
+    StreamSlot *slot;           // Zero-copy source, NULL once spilled
+    const unsigned char *data;
+    size_t data_len, data_off;
+    size_t tail_off;
+    unsigned char *spill;
+    size_t spill_cap;
+    unsigned long last_seq;
+    uint64_t next_due_us;
+} StreamClient;
+
+struct WebcamStreamServer {
+    Webcam *cam;
+    int listen_fd;
+    int epoll_fd;
+    int wake_fd;
+    int running;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    StreamSlot slots[MAX_BUFFERS + STREAM_ENCODED_SLOTS];
+    StreamSlot *latest;
+    WebcamJpegEncoder *encoder; // Created on the first raw frame
+    unsigned long seq;
+    StreamClient *clients;
+    int max_clients;
+    uint64_t interval_us;
+    WebcamStreamStats stats;
+};
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+// Stats are copied by webcam_stream_get_stats() from other threads
+static void stats_add(WebcamStreamServer *srv, unsigned long *counter, unsigned long n) {
+    pthread_mutex_lock(&srv->lock);
+    *counter += n;
+    pthread_mutex_unlock(&srv->lock);
+}
+
+static void stats_clients(WebcamStreamServer *srv, int delta) {
+    pthread_mutex_lock(&srv->lock);
+    srv->stats.clients += delta;
+    pthread_mutex_unlock(&srv->lock);
+}
+
+static void slot_release(WebcamStreamServer *srv, StreamSlot *slot) {
+    pthread_mutex_lock(&srv->lock);
+    int last = (--slot->refs == 0);
+    pthread_mutex_unlock(&srv->lock);
+    if (last && slot->index >= 0) webcam_buffer_unref(srv->cam, slot->index);
+}
+
+static StreamSlot* slot_acquire_latest(WebcamStreamServer *srv) {
+    pthread_mutex_lock(&srv->lock);
+    StreamSlot *slot = srv->latest;
+    if (slot) slot->refs++;
+    pthread_mutex_unlock(&srv->lock);
+    return slot;
+}
+
+static void client_set_out(WebcamStreamServer *srv, StreamClient *c, int on) {
+    if (c->want_out == on) return;
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN | EPOLLRDHUP | (on ? EPOLLOUT : 0);
+    ev.data.ptr = c;
+    epoll_ctl(srv->epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->want_out = on;
+}
+
+static void client_close(WebcamStreamServer *srv, StreamClient *c) {
+    if (c->slot) slot_release(srv, c->slot);
+    c->slot = NULL;
+    epoll_ctl(srv->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    c->fd = -1;
+    c->busy = 0;
+    stats_clients(srv, -1);
+}
+
+// Write as much of the current part as the socket takes. Returns -1 if the
+// client had to be dropped.
+static int client_flush(WebcamStreamServer *srv, StreamClient *c) {
+    static const char tail[2] = {'\r', '\n'};
+
+    while (c->busy) {
+        struct iovec iov[3];
+        int n = 0;
+        if (c->head_off < c->head_len) {
+            iov[n].iov_base = c->head + c->head_off;
+            iov[n++].iov_len = c->head_len - c->head_off;
+        }
+        if (c->data_off < c->data_len) {
+            iov[n].iov_base = (void*)(c->data + c->data_off);
+            iov[n++].iov_len = c->data_len - c->data_off;
+        }
+        if (c->tail_off < sizeof(tail)) {
+            iov[n].iov_base = (void*)(tail + c->tail_off);
+            iov[n++].iov_len = sizeof(tail) - c->tail_off;
+        }
+
+        struct msghdr msg = {0};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n;
+        ssize_t w = sendmsg(c->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                client_set_out(srv, c, 1);
+                return 0;
+            }
+            client_close(srv, c);
+            return -1;
+        }
+
+        size_t left = (size_t)w, step;
+        step = c->head_len - c->head_off;
+        if (step > left) step = left;
+        c->head_off += step; left -= step;
+        step = c->data_len - c->data_off;
+        if (step > left) step = left;
+        c->data_off += step; left -= step;
+        c->tail_off += left;
+
+        if (c->tail_off == sizeof(tail)) {
+            if (c->slot) slot_release(srv, c->slot);
+            c->slot = NULL;
+            c->busy = 0;
+            stats_add(srv, &srv->stats.frames_sent, 1);
+        }
+    }
+    client_set_out(srv, c, 0);
+    return 0;
+}
+
+static void client_start_part(WebcamStreamServer *srv, StreamClient *c, uint64_t now) {
+    StreamSlot *slot = slot_acquire_latest(srv);
+    if (!slot) return;
+
+    int len = 0;
+    if (!c->started) {
+        memcpy(c->head, STREAM_RESPONSE, sizeof(STREAM_RESPONSE) - 1);
+        len = sizeof(STREAM_RESPONSE) - 1;
+        c->started = 1;
+    }
+    len += snprintf(c->head + len, sizeof(c->head) - len,
+                    "--" STREAM_BOUNDARY "\r\n"
+                    "Content-Type: image/jpeg\r\n"
+                    "Content-Length: %zu\r\n\r\n", slot->size);
+
+    if (c->last_seq && slot->seq > c->last_seq + 1)
+        stats_add(srv, &srv->stats.frames_skipped, slot->seq - c->last_seq - 1);
+
+    c->head_len = len;
+    c->head_off = 0;
+    c->slot = slot;
+    c->data = slot->data;
+    c->data_len = slot->size;
+    c->data_off = 0;
+    c->tail_off = 0;
+    c->last_seq = slot->seq;
+    c->next_due_us = now + srv->interval_us;
+    c->busy = 1;
+
+    client_flush(srv, c);
+}
+
+// Viewers still writing a frame that is no longer the newest copy the unsent
+// bytes and let go of the camera buffer.
+static void spill_stale(WebcamStreamServer *srv) {
+    pthread_mutex_lock(&srv->lock);
+    StreamSlot *latest = srv->latest;
+    pthread_mutex_unlock(&srv->lock);
+
+    for (int i = 0; i < srv->max_clients; i++) {
+        StreamClient *c = &srv->clients[i];
+        if (c->fd < 0 || !c->slot || c->slot == latest) continue;
+
+        size_t left = c->data_len - c->data_off;
+        if (left > c->spill_cap) {
+            unsigned char *p = realloc(c->spill, left);
+            if (!p) { client_close(srv, c); continue; }
+            c->spill = p;
+            c->spill_cap = left;
+        }
+        memcpy(c->spill, c->data + c->data_off, left);
+        c->data = c->spill;
+        c->data_len = left;
+        c->data_off = 0;
+        slot_release(srv, c->slot);
+        c->slot = NULL;
+        stats_add(srv, &srv->stats.spills, 1);
+    }
+}
+
+static void accept_clients(WebcamStreamServer *srv) {
+    for (;;) {
+        int fd = accept4(srv->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+
+        StreamClient *c = NULL;
+        for (int i = 0; i < srv->max_clients && !c; i++)
+            if (srv->clients[i].fd < 0) c = &srv->clients[i];
+        if (!c) { close(fd); continue; }
+
+        unsigned char *spill = c->spill;
+        size_t spill_cap = c->spill_cap;
+        memset(c, 0, sizeof(*c));
+        c->fd = fd;
+        c->spill = spill;
+        c->spill_cap = spill_cap;
+
+        struct epoll_event ev = {0};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = c;
+        if (epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            close(fd);
+            c->fd = -1;
+            continue;
+        }
+        stats_clients(srv, 1);
+    }
+}
+
+// Start a part for every idle viewer whose rate limit allows it. Returns the
+// epoll timeout until the next viewer becomes due (-1 = none pending).
+static int pump_clients(WebcamStreamServer *srv) {
+    pthread_mutex_lock(&srv->lock);
+    unsigned long seq = srv->latest ? srv->latest->seq : 0;
+    pthread_mutex_unlock(&srv->lock);
+    if (!seq) return -1;
+
+    uint64_t now = now_us();
+    uint64_t wait = UINT64_MAX;
+    for (int i = 0; i < srv->max_clients; i++) {
+        StreamClient *c = &srv->clients[i];
+        if (c->fd < 0 || c->busy || c->last_seq >= seq) continue;
+        if (c->next_due_us <= now) {
+            client_start_part(srv, c, now);
+        } else if (c->next_due_us - now < wait) {
+            wait = c->next_due_us - now;
+        }
+    }
+    return wait == UINT64_MAX ? -1 : (int)((wait + 999) / 1000);
+}
+
+static void* stream_thread(void *arg) {
+    WebcamStreamServer *srv = arg;
+    struct epoll_event events[STREAM_MAX_EVENTS];
+
+    while (__atomic_load_n(&srv->running, __ATOMIC_ACQUIRE)) {
+        int timeout = pump_clients(srv);
+        int n = epoll_wait(srv->epoll_fd, events, STREAM_MAX_EVENTS, timeout);
+        if (n < 0 && errno != EINTR) break;
+
+        for (int i = 0; i < n; i++) {
+            void *tag = events[i].data.ptr;
+            if (tag == &srv->listen_fd) {
+                accept_clients(srv);
+            } else if (tag == &srv->wake_fd) {
+                uint64_t v;
+                while (read(srv->wake_fd, &v, sizeof(v)) > 0) {}
+                spill_stale(srv);
+            } else {
+                StreamClient *c = tag;
+                if (c->fd < 0) continue;
+                if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+                    client_close(srv, c);
+                    continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    // The request itself is irrelevant; drain it so the
+                    // socket closes cleanly later.
+                    char buf[512];
+                    ssize_t r;
+                    while ((r = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {}
+                    if (r == 0) { client_close(srv, c); continue; }
+                }
+                if (events[i].events & EPOLLOUT) client_flush(srv, c);
+            }
+        }
+    }
+    return NULL;
+}
+
+WEBCAM_API WebcamStreamServer* webcam_stream_start_on(Webcam *cam, const char *address, int port,
+                                                      int max_clients, int max_fps) {
+    if (!cam || port <= 0 || port > 65535) return NULL;
+    if (max_clients <= 0) max_clients = 16;
+
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (!address) addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    else if (inet_pton(AF_INET, address, &addr.sin_addr) != 1) return NULL;
+
+    WebcamStreamServer *srv = calloc(1, sizeof(WebcamStreamServer));
+    if (!srv) return NULL;
+    srv->clients = calloc(max_clients, sizeof(StreamClient));
+    if (!srv->clients) { free(srv); return NULL; }
+
+    srv->cam = cam;
+    srv->max_clients = max_clients;
+    srv->interval_us = max_fps > 0 ? 1000000u / max_fps : 0;
+    for (int i = 0; i < max_clients; i++) srv->clients[i].fd = -1;
+    for (int i = 0; i < STREAM_ENCODED_SLOTS; i++) srv->slots[MAX_BUFFERS + i].index = -1;
+    pthread_mutex_init(&srv->lock, NULL);
+
+    srv->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    srv->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    srv->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (srv->listen_fd < 0 || srv->epoll_fd < 0 || srv->wake_fd < 0) goto fail;
+
+    int one = 1;
+    setsockopt(srv->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (bind(srv->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) goto fail;
+    if (listen(srv->listen_fd, 16) == -1) goto fail;
+
+    struct epoll_event ev = {0};
+    ev.events = EPOLLIN;
+    ev.data.ptr = &srv->listen_fd;
+    if (epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, srv->listen_fd, &ev) == -1) goto fail;
+    ev.data.ptr = &srv->wake_fd;
+    if (epoll_ctl(srv->epoll_fd, EPOLL_CTL_ADD, srv->wake_fd, &ev) == -1) goto fail;
+
+    srv->running = 1;
+    if (pthread_create(&srv->thread, NULL, stream_thread, srv) != 0) goto fail;
+    return srv;
+
+fail:
+    if (srv->listen_fd >= 0) close(srv->listen_fd);
+    if (srv->epoll_fd >= 0) close(srv->epoll_fd);
+    if (srv->wake_fd >= 0) close(srv->wake_fd);
+    pthread_mutex_destroy(&srv->lock);
+    free(srv->clients);
+    free(srv);
+    return NULL;
+}
+
+// Loopback only: exposing the camera to the network must be asked for
+WEBCAM_API WebcamStreamServer* webcam_stream_start(Webcam *cam, int port,
+                                                   int max_clients, int max_fps) {
+    return webcam_stream_start_on(cam, NULL, port, max_clients, max_fps);
+}
+
+// MJPEG frames are sent straight from the camera buffer
+static StreamSlot* slot_from_buffer(WebcamStreamServer *srv, const WebcamFrame *frame) {
+    int index = webcam_buffer_find(srv->cam, frame->data);
+    if (index < 0) return NULL;
+
+    // The slot holds one buffer reference for all its users, so only a slot
+    // that is not already out (the same frame published again) takes it
+    StreamSlot *slot = &srv->slots[index];
+    pthread_mutex_lock(&srv->lock);
+    if (slot->refs == 0) {
+        webcam_buffer_ref(srv->cam, index);
+        slot->index = index;
+        slot->data = frame->data;
+        slot->size = (size_t)frame->size;
+    }
+    slot->refs++;   // Owned by srv->latest once published
+    pthread_mutex_unlock(&srv->lock);
+    return slot;
+}
+
+// Raw frames are encoded into a free server-owned slot
+static StreamSlot* slot_from_encoder(WebcamStreamServer *srv, const WebcamFrame *frame) {
+    if (!srv->encoder) srv->encoder = webcam_jpeg_create(srv->cam, STREAM_JPEG_QUALITY);
+    if (!srv->encoder) return NULL;
+
+    StreamSlot *slot = NULL;
+    pthread_mutex_lock(&srv->lock);
+    for (int i = MAX_BUFFERS; i < MAX_BUFFERS + STREAM_ENCODED_SLOTS && !slot; i++)
+        if (srv->slots[i].refs == 0) slot = &srv->slots[i];
+    if (slot) slot->refs = 1;   // Reserved while encoding
+    pthread_mutex_unlock(&srv->lock);
+    if (!slot) return NULL;
+
+    // Sized once to the MJPEG bound of the frame so each frame is encoded once;
+    // one that still does not fit grows the buffer with headroom
+    size_t size = webcam_frame_size(WEBCAM_FMT_MJPEG, frame->width, frame->height);
+    if (slot->jpeg_cap < size) {
+        unsigned char *p = realloc(slot->jpeg, size);
+        if (p) {
+            slot->jpeg = p;
+            slot->jpeg_cap = size;
+        }
+    }
+    int r = webcam_jpeg_encode(srv->encoder, frame, slot->jpeg, slot->jpeg_cap, &size);
+    if (r != 0 && size > slot->jpeg_cap) {
+        size += size / 4;
+        unsigned char *p = realloc(slot->jpeg, size);
+        if (p) {
+            slot->jpeg = p;
+            slot->jpeg_cap = size;
+            r = webcam_jpeg_encode(srv->encoder, frame, slot->jpeg, slot->jpeg_cap, &size);
+        }
+    }
+    if (r != 0) {
+        pthread_mutex_lock(&srv->lock);
+        slot->refs = 0;
+        pthread_mutex_unlock(&srv->lock);
+        return NULL;
+    }
+    slot->data = slot->jpeg;
+    slot->size = size;
+    return slot;
+}
+
+WEBCAM_API int webcam_stream_publish(WebcamStreamServer *srv, const WebcamFrame *frame) {
+    if (!srv || !frame) return -1;
+
+    StreamSlot *slot = frame->format == WEBCAM_FMT_MJPEG ? slot_from_buffer(srv, frame)
+                                                         : slot_from_encoder(srv, frame);
+    if (!slot) return -1;
+
+    // Both slot sources hand over one reference, which srv->latest keeps
+    pthread_mutex_lock(&srv->lock);
+    if (slot == srv->latest) {
+        slot->refs--;
+        pthread_mutex_unlock(&srv->lock);
+        return 0;
+    }
+    slot->seq = ++srv->seq;
+    StreamSlot *old = srv->latest;
+    srv->latest = slot;
+    srv->stats.frames_published++;
+    pthread_mutex_unlock(&srv->lock);
+
+    if (old) slot_release(srv, old);
+
+    uint64_t one = 1;
+    ssize_t r = write(srv->wake_fd, &one, sizeof(one));
+    (void)r;
+    return 0;
+}
+
+WEBCAM_API void webcam_stream_get_stats(WebcamStreamServer *srv, WebcamStreamStats *stats) {
+    if (!srv || !stats) return;
+    pthread_mutex_lock(&srv->lock);
+    *stats = srv->stats;
+    pthread_mutex_unlock(&srv->lock);
+}
+
+WEBCAM_API void webcam_stream_stop(WebcamStreamServer *srv) {
+    if (!srv) return;
+
+    __atomic_store_n(&srv->running, 0, __ATOMIC_RELEASE);
+    uint64_t one = 1;
+    ssize_t r = write(srv->wake_fd, &one, sizeof(one));
+    (void)r;
+    pthread_join(srv->thread, NULL);
+
+    for (int i = 0; i < srv->max_clients; i++) {
+        if (srv->clients[i].fd >= 0) client_close(srv, &srv->clients[i]);
+        free(srv->clients[i].spill);
+    }
+    if (srv->latest) slot_release(srv, srv->latest);
+    for (int i = MAX_BUFFERS; i < MAX_BUFFERS + STREAM_ENCODED_SLOTS; i++)
+        free(srv->slots[i].jpeg);
+    webcam_jpeg_destroy(srv->encoder);
+
+    close(srv->listen_fd);
+    close(srv->epoll_fd);
+    close(srv->wake_fd);
+    pthread_mutex_destroy(&srv->lock);
+    free(srv->clients);
+    free(srv);
+}
+
+#else // !__linux__
+
+#include "webcam.h"
+#include <stddef.h>
+
+WEBCAM_API WebcamStreamServer* webcam_stream_start(Webcam *cam, int port,
+                                                   int max_clients, int max_fps) {
+    (void)cam; (void)port; (void)max_clients; (void)max_fps;
+    return NULL;
+}
+
+WEBCAM_API WebcamStreamServer* webcam_stream_start_on(Webcam *cam, const char *address, int port,
+                                                      int max_clients, int max_fps) {
+    (void)cam; (void)address; (void)port; (void)max_clients; (void)max_fps;
+    return NULL;
+}
+
+WEBCAM_API int webcam_stream_publish(WebcamStreamServer *srv, const WebcamFrame *frame) {
+    (void)srv; (void)frame;
+    return -1;
+}
+
+WEBCAM_API void webcam_stream_get_stats(WebcamStreamServer *srv, WebcamStreamStats *stats) {
+    (void)srv; (void)stats;
+}
+
+WEBCAM_API void webcam_stream_stop(WebcamStreamServer *srv) {
+    (void)srv;
+}
+
+#endif // __linux__
@@ -0,0 +1,182 @@
+// ============================================================================
+// webcam_sync.c - Synchronized multi-camera frame sets
+// ============================================================================
+// Every camera keeps at most one candidate frame. Once all cameras have one,
+// the set is delivered if the spread of kernel timestamps fits the tolerance;
+// otherwise the oldest candidate is dropped and that camera is read again.
+// Frames are handed out as held V4L2 buffers, never copied.
+// ============================================================================
+#ifdef __linux__
+
+#include "webcam_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+
+struct WebcamSyncGroup {
+    Webcam *cams[WEBCAM_SYNC_MAX_CAMERAS];
+    int count;
+    uint64_t tolerance_us;
+    WebcamFrame pending[WEBCAM_SYNC_MAX_CAMERAS];
+    int has_pending[WEBCAM_SYNC_MAX_CAMERAS];
+    WebcamSyncStats stats;
+    uint64_t skew_sum_us;
+};
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+WEBCAM_API WebcamSyncGroup* webcam_sync_create(Webcam **cams, int count, int tolerance_us) {
+    if (!cams || count < 1 || count > WEBCAM_SYNC_MAX_CAMERAS || tolerance_us < 0)
+        return NULL;
+    for (int i = 0; i < count; i++)
+        if (!cams[i]) return NULL;
+
+    WebcamSyncGroup *group = calloc(1, sizeof(WebcamSyncGroup));
+    if (!group) return NULL;
+
+    memcpy(group->cams, cams, count * sizeof(Webcam*));
+    group->count = count;
+    group->tolerance_us = (uint64_t)tolerance_us;
+    return group;
+}
+
+// Fill every empty candidate slot (deadline_ms < 0: no deadline). Returns 0
+// when all cameras have a frame, -2 on timeout, -1 on error.
+static int fill_pending(WebcamSyncGroup *group, int64_t deadline_ms) {
+    for (;;) {
+        struct pollfd fds[WEBCAM_SYNC_MAX_CAMERAS];
+        int map[WEBCAM_SYNC_MAX_CAMERAS];
+        int n = 0;
+
+        for (int i = 0; i < group->count; i++) {
+            if (group->has_pending[i]) continue;
+            fds[n].fd = group->cams[i]->fd;
+            fds[n].events = POLLIN;
+            fds[n].revents = 0;
+            map[n++] = i;
+        }
+        if (n == 0) return 0;
+
+        int64_t left = deadline_ms < 0 ? -1 : deadline_ms - now_ms();
+        if (deadline_ms >= 0 && left < 0) left = 0;
+        int r = poll(fds, n, (int)left);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (r == 0) return -2;
+
+        for (int k = 0; k < n; k++) {
+            if (!(fds[k].revents & (POLLIN | POLLERR))) continue;
+            int i = map[k];
+            // Readable fd; nothing left if the frame was decimated
+            int c = webcam_try_capture(group->cams[i], &group->pending[i]);
+            if (c == -2) continue;
+            if (c != 0) return -1;
+            group->has_pending[i] = 1;
+        }
+    }
+}
+
+WEBCAM_API int webcam_sync_capture(WebcamSyncGroup *group, WebcamFrameSet *set, int timeout_ms) {
+    if (!group || !set) return -1;
+
+    int64_t deadline = timeout_ms < 0 ? -1 : now_ms() + timeout_ms;
+    for (;;) {
+        int r = fill_pending(group, deadline);
+        if (r != 0) {
+            if (r == -2) group->stats.timeouts++;
+            return r;
+        }
+
+        int oldest = 0;
+        uint64_t lo = group->pending[0].timestamp_us;
+        uint64_t hi = lo;
+        for (int i = 1; i < group->count; i++) {
+            uint64_t ts = group->pending[i].timestamp_us;
+            if (ts < lo) { lo = ts; oldest = i; }
+            if (ts > hi) hi = ts;
+        }
+
+        if (hi - lo <= group->tolerance_us) {
+            set->count = group->count;
+            set->timestamp_us = lo;
+            set->skew_us = hi - lo;
+            for (int i = 0; i < group->count; i++) {
+                set->frames[i] = group->pending[i];
+                group->has_pending[i] = 0;
+            }
+
+            group->stats.sets++;
+            group->stats.last_skew_us = set->skew_us;
+            if (set->skew_us > group->stats.max_skew_us)
+                group->stats.max_skew_us = set->skew_us;
+            group->skew_sum_us += set->skew_us;
+            group->stats.mean_skew_us = group->skew_sum_us / group->stats.sets;
+            return 0;
+        }
+
+        // The oldest frame can no longer find partners inside the window
+        webcam_return_frame(group->cams[oldest], &group->pending[oldest]);
+        group->has_pending[oldest] = 0;
+        group->stats.unmatched++;
+        if (deadline >= 0 && now_ms() > deadline) {
+            group->stats.timeouts++;
+            return -2;
+        }
+    }
+}
+
+WEBCAM_API void webcam_sync_release(WebcamSyncGroup *group, WebcamFrameSet *set) {
+    if (!group || !set) return;
+    for (int i = 0; i < set->count && i < group->count; i++)
+        webcam_return_frame(group->cams[i], &set->frames[i]);
+    set->count = 0;
+}
+
+WEBCAM_API void webcam_sync_get_stats(WebcamSyncGroup *group, WebcamSyncStats *stats) {
+    if (group && stats) *stats = group->stats;
+}
+
+WEBCAM_API void webcam_sync_destroy(WebcamSyncGroup *group) {
+    if (!group) return;
+    for (int i = 0; i < group->count; i++)
+        if (group->has_pending[i])
+            webcam_return_frame(group->cams[i], &group->pending[i]);
+    free(group);
+}
+
+#else // !__linux__
+
+#include "webcam.h"
+#include <stddef.h>
+
+WEBCAM_API WebcamSyncGroup* webcam_sync_create(Webcam **cams, int count, int tolerance_us) {
+    (void)cams; (void)count; (void)tolerance_us;
+    return NULL;
+}
+
+WEBCAM_API int webcam_sync_capture(WebcamSyncGroup *group, WebcamFrameSet *set, int timeout_ms) {
+    (void)group; (void)set; (void)timeout_ms;
+    return -1;
+}
+
+WEBCAM_API void webcam_sync_release(WebcamSyncGroup *group, WebcamFrameSet *set) {
+    (void)group; (void)set;
+}
+
+WEBCAM_API void webcam_sync_get_stats(WebcamSyncGroup *group, WebcamSyncStats *stats) {
+    (void)group; (void)stats;
+}
+
+WEBCAM_API void webcam_sync_destroy(WebcamSyncGroup *group) {
+    (void)group;
+}
+
+#endif // __linux__
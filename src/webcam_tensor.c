@@ -0,0 +1,257 @@
+// ============================================================================
+// webcam_tensor.c - Fused frame -> tensor preprocessing for inference
+// ============================================================================
+// Resize, color conversion and normalization happen in one pass over the
+// native buffer: for each tensor row the two source rows it needs are sampled
+// horizontally (Y/U/V or R/G/B, bilinear) into small L1-resident scratch
+// rows, then blended vertically and converted to RGB by the shared row
+// kernels (webcam_kernels.c) and written straight into the caller's tensor
+// through a per-channel lookup table.
+// ============================================================================
+#include "webcam_internal.h"
+#include <string.h>
+
+#define MAX_TENSOR_WIDTH 4096
+
+typedef struct {
+    const WebcamFrame *src;
+    const WebcamTensorSpec *spec;
+    void *dst;
+    int is_yuv;
+
+    // Content rectangle inside the tensor (the rest is letterbox padding)
+    int cx, cy, cw, ch;
+    // Source rows for content row r: origin + (r + 0.5) * step - 0.5
+    double sy_origin, sy_step;
+    // Per content column: left source column and 8-bit weight of the right one
+    int x0[MAX_TENSOR_WIDTH];
+    int x1[MAX_TENSOR_WIDTH];
+    unsigned char fx[MAX_TENSOR_WIDTH];
+
+    int order[3];               // Output channel k takes RGB component order[k]
+    float lut[3][256];          // Float layouts: value -> normalized, per output channel
+    unsigned char pad_u8;
+} TensorJob;
+
+// Horizontal pass for one source row: three channels in 8.8 fixed point
+void webcam_sample_row(const WebcamFrame *src, int y, const int *x0, const int *x1,
+                       const unsigned char *fx, int n, unsigned short *const out[3]) {
+    const int W = src->width, H = src->height;
+
+#define BLEND(ch, a, b) out[ch][c] = (unsigned short)((a) * (256 - fx[c]) + (b) * fx[c])
+
+    switch (src->format) {
+        case WEBCAM_FMT_YUYV: {
+            const unsigned char *s = src->data + (size_t)y * W * 2;
+            for (int c = 0; c < n; c++) {
+                const unsigned char *p = s + (x0[c] >> 1) * 4, *q = s + (x1[c] >> 1) * 4;
+                BLEND(0, p[(x0[c] & 1) * 2], q[(x1[c] & 1) * 2]);
+                BLEND(1, p[1], q[1]);
+                BLEND(2, p[3], q[3]);
+            }
+            break;
+        }
+        case WEBCAM_FMT_YUV420: {
+            const unsigned char *py = src->data + (size_t)y * W;
+            const unsigned char *pu = src->data + (size_t)W * H + (size_t)(y >> 1) * (W >> 1);
+            const unsigned char *pv = pu + (size_t)(W >> 1) * (H >> 1);
+            for (int c = 0; c < n; c++) {
+                BLEND(0, py[x0[c]], py[x1[c]]);
+                BLEND(1, pu[x0[c] >> 1], pu[x1[c] >> 1]);
+                BLEND(2, pv[x0[c] >> 1], pv[x1[c] >> 1]);
+            }
+            break;
+        }
+        case WEBCAM_FMT_NV12: {
+            const unsigned char *py = src->data + (size_t)y * W;
+            const unsigned char *puv = src->data + (size_t)W * H + (size_t)(y >> 1) * W;
+            for (int c = 0; c < n; c++) {
+                const unsigned char *p = puv + (x0[c] & ~1), *q = puv + (x1[c] & ~1);
+                BLEND(0, py[x0[c]], py[x1[c]]);
+                BLEND(1, p[0], q[0]);
+                BLEND(2, p[1], q[1]);
+            }
+            break;
+        }
+        case WEBCAM_FMT_GRAY8: {
+            const unsigned char *s = src->data + (size_t)y * W;
+            for (int c = 0; c < n; c++) {
+                BLEND(0, s[x0[c]], s[x1[c]]);
+                out[1][c] = out[2][c] = out[0][c];
+            }
+            break;
+        }
+        case WEBCAM_FMT_RGB24:
+        case WEBCAM_FMT_RGB32: {
+            const int bpp = src->format == WEBCAM_FMT_RGB24 ? 3 : 4;
+            const unsigned char *s = src->data + (size_t)y * W * bpp;
+            for (int c = 0; c < n; c++) {
+                const unsigned char *p = s + x0[c] * bpp, *q = s + x1[c] * bpp;
+                BLEND(0, p[0], q[0]);
+                BLEND(1, p[1], q[1]);
+                BLEND(2, p[2], q[2]);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+#undef BLEND
+}
+
+static void sample_row(const TensorJob *job, int y, unsigned short out[3][MAX_TENSOR_WIDTH]) {
+    unsigned short *const planes[3] = { out[0], out[1], out[2] };
+    webcam_sample_row(job->src, y, job->x0, job->x1, job->fx, job->cw, planes);
+}
+
+// Write `n` RGB pixels to tensor row r starting at column c0
+static void store_line(const TensorJob *job, int r, int c0, int n, const unsigned char *rgb) {
+    const WebcamTensorSpec *spec = job->spec;
+    const size_t plane = (size_t)spec->width * spec->height;
+    const size_t at = (size_t)r * spec->width + c0;
+    const int o0 = job->order[0], o1 = job->order[1], o2 = job->order[2];
+
+    switch (spec->layout) {
+        case WEBCAM_TENSOR_U8_NHWC: {
+            unsigned char *d = (unsigned char*)job->dst + at * 3;
+            for (int i = 0; i < n; i++, d += 3, rgb += 3) {
+                d[0] = rgb[o0]; d[1] = rgb[o1]; d[2] = rgb[o2];
+            }
+            break;
+        }
+        case WEBCAM_TENSOR_F32_NHWC: {
+            float *d = (float*)job->dst + at * 3;
+            for (int i = 0; i < n; i++, d += 3, rgb += 3) {
+                d[0] = job->lut[0][rgb[o0]];
+                d[1] = job->lut[1][rgb[o1]];
+                d[2] = job->lut[2][rgb[o2]];
+            }
+            break;
+        }
+        case WEBCAM_TENSOR_F32_NCHW: {
+            float *d0 = (float*)job->dst + at, *d1 = d0 + plane, *d2 = d1 + plane;
+            for (int i = 0; i < n; i++, rgb += 3) {
+                d0[i] = job->lut[0][rgb[o0]];
+                d1[i] = job->lut[1][rgb[o1]];
+                d2[i] = job->lut[2][rgb[o2]];
+            }
+            break;
+        }
+    }
+}
+
+static void tensor_rows(void *ctx, int begin, int end) {
+    const TensorJob *job = (const TensorJob*)ctx;
+    const int W = job->spec->width, sh = job->src->height;
+    unsigned short rows[2][3][MAX_TENSOR_WIDTH];
+    short rgb[3][MAX_TENSOR_WIDTH];
+    unsigned char line[MAX_TENSOR_WIDTH * 3];
+    unsigned short *const a[3] = { rows[0][0], rows[0][1], rows[0][2] };
+    unsigned short *const b[3] = { rows[1][0], rows[1][1], rows[1][2] };
+    short *const planes[3] = { rgb[0], rgb[1], rgb[2] };
+    int cached[2] = { -1, -1 };
+
+    for (int r = begin; r < end; r++) {
+        if (r < job->cy || r >= job->cy + job->ch) {
+            memset(line, job->pad_u8, (size_t)W * 3);
+            store_line(job, r, 0, W, line);
+            continue;
+        }
+        if (job->cw < W) {
+            memset(line, job->pad_u8, (size_t)W * 3);
+            store_line(job, r, 0, job->cx, line);
+            store_line(job, r, job->cx + job->cw, W - job->cx - job->cw, line);
+        }
+
+        double sy = job->sy_origin + (r - job->cy + 0.5) * job->sy_step - 0.5;
+        if (sy < 0) sy = 0;
+        if (sy > sh - 1) sy = sh - 1;
+        int y0 = (int)sy;
+        int y1 = y0 + 1 < sh ? y0 + 1 : y0;
+        int fy = (int)((sy - y0) * 256.0);
+
+        if (cached[0] != y0) {
+            if (cached[1] == y0) memcpy(rows[0], rows[1], sizeof(rows[0]));
+            else sample_row(job, y0, rows[0]);
+            cached[0] = y0;
+        }
+        if (fy && cached[1] != y1) {
+            sample_row(job, y1, rows[1]);
+            cached[1] = y1;
+        }
+
+        webcam_blend_rows(a, b, fy, job->cw, planes);
+        if (job->is_yuv) webcam_yuv_to_rgb(planes, job->cw);
+        webcam_pack_rgb(planes, job->cw, line, 3);
+        store_line(job, r, job->cx, job->cw, line);
+    }
+}
+
+WEBCAM_API int webcam_preprocess(Webcam *cam, const WebcamFrame *src,
+                                 const WebcamTensorSpec *spec, void *dst,
+                                 WebcamTensorMap *map) {
+    if (!webcam_frame_valid(src) || webcam_is_bayer(src->format) || !spec || !dst) return -1;
+    if (spec->width <= 0 || spec->height <= 0 || spec->width > MAX_TENSOR_WIDTH) return -1;
+    if (spec->layout < WEBCAM_TENSOR_U8_NHWC || spec->layout > WEBCAM_TENSOR_F32_NCHW) return -1;
+
+    TensorJob job;
+    memset(&job, 0, sizeof(job));
+    job.src = src;
+    job.spec = spec;
+    job.dst = dst;
+    job.is_yuv = src->format == WEBCAM_FMT_YUYV || src->format == WEBCAM_FMT_YUV420 ||
+                 src->format == WEBCAM_FMT_NV12;
+
+    // Geometry: source region [sx, sx + sw) x [sy, sy + sh) lands on the content rect
+    const double SW = src->width, SH = src->height, TW = spec->width, TH = spec->height;
+    double sx = 0, sy = 0, sw = SW, sh = SH;
+    job.cx = 0; job.cy = 0; job.cw = spec->width; job.ch = spec->height;
+
+    if (spec->fit == WEBCAM_FIT_LETTERBOX) {
+        double s = TW / SW < TH / SH ? TW / SW : TH / SH;
+        job.cw = (int)(SW * s + 0.5);
+        job.ch = (int)(SH * s + 0.5);
+        if (job.cw < 1) job.cw = 1;
+        if (job.ch < 1) job.ch = 1;
+        job.cx = (spec->width - job.cw) / 2;
+        job.cy = (spec->height - job.ch) / 2;
+    } else if (spec->fit == WEBCAM_FIT_CENTER_CROP) {
+        double s = TW / SW > TH / SH ? TW / SW : TH / SH;
+        sw = TW / s;
+        sh = TH / s;
+        sx = (SW - sw) / 2;
+        sy = (SH - sh) / 2;
+    }
+
+    double sx_step = sw / job.cw;
+    job.sy_origin = sy;
+    job.sy_step = sh / job.ch;
+    for (int c = 0; c < job.cw; c++) {
+        double x = sx + (c + 0.5) * sx_step - 0.5;
+        if (x < 0) x = 0;
+        if (x > SW - 1) x = SW - 1;
+        job.x0[c] = (int)x;
+        job.x1[c] = job.x0[c] + 1 < src->width ? job.x0[c] + 1 : job.x0[c];
+        job.fx[c] = (unsigned char)((x - job.x0[c]) * 256.0);
+    }
+
+    for (int k = 0; k < 3; k++) {
+        int comp = spec->bgr ? 2 - k : k;
+        float mean = spec->mean[comp];
+        float std = spec->std[comp] != 0.0f ? spec->std[comp] : 1.0f;
+        job.order[k] = comp;
+        for (int v = 0; v < 256; v++)
+            job.lut[k][v] = (v / 255.0f - mean) / std;
+    }
+    job.pad_u8 = spec->pad_value;
+
+    webcam_parallel_rows(webcam_get_workers(cam), spec->height, tensor_rows, &job);
+
+    if (map) {
+        map->scale_x = (float)(job.cw / sw);
+        map->scale_y = (float)(job.ch / sh);
+        map->offset_x = (float)(job.cx - sx * map->scale_x);
+        map->offset_y = (float)(job.cy - sy * map->scale_y);
+    }
+    return 0;
+}
@@ -3,7 +3,7 @@
 // ============================================================================
 #ifdef _WIN32
 
-#include "webcam.h"
+#include "webcam_internal.h"
 #include <windows.h>
 #include <mfapi.h>
 #include <mfidl.h>
@@ -21,8 +21,74 @@ template <class T> void SafeRelease(T **ppT) {
     if (*ppT) { (*ppT)->Release(); *ppT = NULL; }
 }
 
+// The reader runs asynchronously so captures can time out: one ReadSample()
+// request is kept outstanding and its sample is parked here until the
+// capture call, which waits on `ready` for as long as its timeout allows
+class SampleCallback : public IMFSourceReaderCallback {
+public:
+    SampleCallback() : sample(NULL), status(S_OK), time(0), arrived_us(0), pending(false), refs_(1) {
+        InitializeCriticalSection(&lock);
+        ready = CreateEvent(NULL, TRUE, FALSE, NULL);
+        flushed = CreateEvent(NULL, FALSE, FALSE, NULL);
+    }
+
+    STDMETHODIMP QueryInterface(REFIID iid, void **ppv) {
+        if (!ppv) return E_POINTER;
+        if (iid == __uuidof(IUnknown) || iid == __uuidof(IMFSourceReaderCallback)) {
+            *ppv = static_cast<IMFSourceReaderCallback*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+    STDMETHODIMP_(ULONG) AddRef() { return InterlockedIncrement(&refs_); }
+    STDMETHODIMP_(ULONG) Release() {
+        ULONG n = InterlockedDecrement(&refs_);
+        if (!n) delete this;
+        return n;
+    }
+
+    STDMETHODIMP OnReadSample(HRESULT hr, DWORD, DWORD flags, LONGLONG timestamp, IMFSample *s) {
+        if (SUCCEEDED(hr) && (flags & (MF_SOURCE_READERF_ERROR | MF_SOURCE_READERF_ENDOFSTREAM)))
+            hr = E_FAIL;
+        EnterCriticalSection(&lock);
+        if (s) s->AddRef();
+        SafeRelease(&sample);
+        sample = s;             // NULL for a stream tick: the capture asks again
+        status = hr;
+        time = timestamp;
+        arrived_us = webcam_now_us();
+        pending = false;
+        SetEvent(ready);
+        LeaveCriticalSection(&lock);
+        return S_OK;
+    }
+    STDMETHODIMP OnFlush(DWORD) { SetEvent(flushed); return S_OK; }
+    STDMETHODIMP OnEvent(DWORD, IMFMediaEvent*) { return S_OK; }
+
+    CRITICAL_SECTION lock;
+    HANDLE ready;               // Manual reset: set while a result is parked
+    HANDLE flushed;
+    IMFSample *sample;
+    HRESULT status;
+    LONGLONG time;              // 100 ns units
+    uint64_t arrived_us;        // webcam_now_us() when delivered
+    bool pending;               // A ReadSample() request is outstanding
+
+private:
+    virtual ~SampleCallback() {
+        SafeRelease(&sample);
+        CloseHandle(ready);
+        CloseHandle(flushed);
+        DeleteCriticalSection(&lock);
+    }
+    volatile LONG refs_;
+};
+
 struct Webcam {
     IMFSourceReader *reader;
+    SampleCallback *callback;
     IAMVideoProcAmp *procAmp;
     IAMCameraControl *camControl;
     int actual_width;
@@ -30,6 +96,10 @@ struct Webcam {
     WebcamPixelFormat format;
     IMFSample *current_sample;
     IMFMediaBuffer *current_buffer;
+    WebcamWorkers *workers;
+    WebcamDecimator decimator;
+    WebcamControls controls;
+    WebcamRtProfile rt;         // Applied to worker threads, also future ones
 };
 
 extern "C" {
@@ -134,7 +204,7 @@ WEBCAM_API WebcamCapabilities* webcam_query_capabilities(int device_index) {
         MF_SOURCE_READER_FIRST_VIDEO_STREAM, dwIndex, &pType))) {
         
         GUID subtype;
-        UINT32 w, h;
+        UINT32 w, h, rate_num = 0, rate_den = 0;
         
                     if (SUCCEEDED(pType->GetGUID(MF_MT_SUBTYPE, &subtype)) &&
             SUCCEEDED(MFGetAttributeSize(pType, MF_MT_FRAME_SIZE, &w, &h))) {
@@ -147,13 +217,16 @@ WEBCAM_API WebcamCapabilities* webcam_query_capabilities(int device_index) {
             else if (IsEqualGUID(subtype, MFVideoFormat_YUY2)) fmt = WEBCAM_FMT_YUYV;
             else if (IsEqualGUID(subtype, MFVideoFormat_I420)) fmt = WEBCAM_FMT_YUV420;
             else if (IsEqualGUID(subtype, MFVideoFormat_MJPG)) fmt = WEBCAM_FMT_MJPEG;
+            else if (IsEqualGUID(subtype, MFVideoFormat_NV12)) fmt = WEBCAM_FMT_NV12;
+            else if (IsEqualGUID(subtype, MFVideoFormat_L8)) fmt = WEBCAM_FMT_GRAY8;
             else recognized = 0;
             
             if (recognized && format_count < 100) {
                 formats[format_count].format = fmt;
                 formats[format_count].width = w;
                 formats[format_count].height = h;
-                formats[format_count].fps = 30;
+                MFGetAttributeRatio(pType, MF_MT_FRAME_RATE, &rate_num, &rate_den);
+                formats[format_count].fps = rate_den ? (int)((rate_num + rate_den / 2) / rate_den) : 0;
                 
                 if (w > caps->max_width) caps->max_width = w;
                 if (h > caps->max_height) caps->max_height = h;
@@ -177,6 +250,11 @@ WEBCAM_API WebcamCapabilities* webcam_query_capabilities(int device_index) {
 
 WEBCAM_API Webcam* webcam_open(int width, int height, int device_index,
                                WebcamPixelFormat format) {
+    return webcam_open_fps(width, height, device_index, format, 0);
+}
+
+WEBCAM_API Webcam* webcam_open_fps(int width, int height, int device_index,
+                                   WebcamPixelFormat format, int fps) {
     HRESULT hr = MFStartup(MF_VERSION);
     if (FAILED(hr)) return NULL;
     
@@ -202,10 +280,16 @@ WEBCAM_API Webcam* webcam_open(int width, int height, int device_index,
     CoTaskMemFree(ppDevices);
     if (FAILED(hr)) return NULL;
 
+    SampleCallback *callback = new SampleCallback();
+    IMFAttributes *pReaderConfig = NULL;
     IMFSourceReader *pReader = NULL;
-    hr = MFCreateSourceReaderFromMediaSource(pSource, NULL, &pReader);
+    hr = MFCreateAttributes(&pReaderConfig, 1);
+    if (SUCCEEDED(hr)) hr = pReaderConfig->SetUnknown(MF_SOURCE_READER_ASYNC_CALLBACK, callback);
+    if (SUCCEEDED(hr)) hr = MFCreateSourceReaderFromMediaSource(pSource, pReaderConfig, &pReader);
+    SafeRelease(&pReaderConfig);
 
     if (FAILED(hr)) {
+        SafeRelease(&callback);
         SafeRelease(&pSource);
         return NULL;
     }
@@ -230,9 +314,16 @@ WEBCAM_API Webcam* webcam_open(int width, int height, int device_index,
         case WEBCAM_FMT_MJPEG:
             pType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_MJPG);
             break;
+        case WEBCAM_FMT_NV12:
+            pType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_NV12);
+            break;
+        case WEBCAM_FMT_GRAY8:
+            pType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_L8);
+            break;
     }
     
     MFSetAttributeSize(pType, MF_MT_FRAME_SIZE, width, height);
+    if (fps > 0) MFSetAttributeRatio(pType, MF_MT_FRAME_RATE, fps, 1);
     hr = pReader->SetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, NULL, pType);
     
     if (FAILED(hr)) {
@@ -255,6 +346,12 @@ WEBCAM_API Webcam* webcam_open(int width, int height, int device_index,
             case WEBCAM_FMT_MJPEG:
                 pType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_MJPG);
                 break;
+            case WEBCAM_FMT_NV12:
+                pType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_NV12);
+                break;
+            case WEBCAM_FMT_GRAY8:
+                pType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_L8);
+                break;
         }
         
         hr = pReader->SetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, NULL, pType);
@@ -263,6 +360,7 @@ WEBCAM_API Webcam* webcam_open(int width, int height, int device_index,
 
     if (FAILED(hr)) {
         SafeRelease(&pReader);
+        SafeRelease(&callback);
         SafeRelease(&pSource);
         return NULL;
     }
@@ -278,11 +376,15 @@ WEBCAM_API Webcam* webcam_open(int width, int height, int device_index,
 
     Webcam *cam = new Webcam();
     cam->reader = pReader;
+    cam->callback = callback;
     cam->actual_width = final_w;
     cam->actual_height = final_h;
     cam->format = format;
     cam->current_sample = NULL;
     cam->current_buffer = NULL;
+    cam->workers = NULL;
+    webcam_decimator_set(&cam->decimator, 1, 0);
+    webcam_controls_init(&cam->controls);
     
     pSource->QueryInterface(IID_PPV_ARGS(&cam->procAmp));
     pSource->QueryInterface(IID_PPV_ARGS(&cam->camControl));
@@ -291,18 +393,94 @@ WEBCAM_API Webcam* webcam_open(int width, int height, int device_index,
     return cam;
 }
 
+uint64_t webcam_now_us(void) {
+    LARGE_INTEGER qpc, freq;
+    QueryPerformanceCounter(&qpc);
+    QueryPerformanceFrequency(&freq);
+    return (uint64_t)(qpc.QuadPart / freq.QuadPart) * 1000000u +
+           (uint64_t)(qpc.QuadPart % freq.QuadPart) * 1000000u / freq.QuadPart;
+}
+
 WEBCAM_API int webcam_capture(Webcam *cam, WebcamFrame *frame) {
+    return webcam_capture_timeout(cam, frame, 2000000);
+}
+
+WEBCAM_API int webcam_try_capture(Webcam *cam, WebcamFrame *frame) {
+    return webcam_capture_timeout(cam, frame, 0);
+}
+
+// Keeps one request outstanding (none while a sample is parked)
+static HRESULT request_sample(Webcam *cam) {
+    SampleCallback *cb = cam->callback;
+    HRESULT hr = S_OK;
+    // Under the lock, so a callback on another thread sees pending set
+    EnterCriticalSection(&cb->lock);
+    if (!cb->pending && !cb->sample) {
+        hr = cam->reader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, NULL, NULL, NULL, NULL);
+        if (SUCCEEDED(hr)) cb->pending = true;
+    }
+    LeaveCriticalSection(&cb->lock);
+    return hr;
+}
+
+// Cancels the outstanding request and drops any parked sample
+static void flush_reader(Webcam *cam) {
+    SampleCallback *cb = cam->callback;
+    if (SUCCEEDED(cam->reader->Flush(MF_SOURCE_READER_ALL_STREAMS)))
+        WaitForSingleObject(cb->flushed, 1000);
+    EnterCriticalSection(&cb->lock);
+    SafeRelease(&cb->sample);
+    cb->status = S_OK;
+    cb->pending = false;
+    ResetEvent(cb->ready);
+    LeaveCriticalSection(&cb->lock);
+}
+
+WEBCAM_API int webcam_capture_timeout(Webcam *cam, WebcamFrame *frame, long timeout_us) {
     if (!cam || !cam->reader || !frame) return -1;
+    webcam_controls_apply(cam);
     
     // Release previous sample if any
     SafeRelease(&cam->current_buffer);
     SafeRelease(&cam->current_sample);
     
-    DWORD flags = 0;
-    HRESULT hr = cam->reader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM, 
-                                         0, NULL, &flags, NULL, &cam->current_sample);
-    
-    if (FAILED(hr) || !cam->current_sample) return -1;
+    // The timeout covers decimated samples too
+    SampleCallback *cb = cam->callback;
+    const uint64_t deadline = timeout_us > 0 ? webcam_now_us() + (uint64_t)timeout_us : 0;
+    uint64_t arrived_us = 0;
+    for (;;) {
+        if (FAILED(request_sample(cam))) return -1;
+
+        DWORD wait = timeout_us < 0 ? INFINITE : 0;
+        if (timeout_us > 0) {
+            uint64_t now = webcam_now_us();
+            if (now < deadline) wait = (DWORD)((deadline - now + 999) / 1000);
+        }
+        // On timeout the request stays outstanding for the next call
+        if (WaitForSingleObject(cb->ready, wait) != WAIT_OBJECT_0) return -2;
+
+        EnterCriticalSection(&cb->lock);
+        IMFSample *sample = cb->sample;
+        HRESULT hr = cb->status;
+        LONGLONG sample_time = cb->time;
+        arrived_us = cb->arrived_us;
+        cb->sample = NULL;
+        cb->status = S_OK;
+        ResetEvent(cb->ready);
+        LeaveCriticalSection(&cb->lock);
+
+        if (FAILED(hr)) {
+            SafeRelease(&sample);
+            return -1;
+        }
+        if (!sample) continue;
+        if (!webcam_decimator_skip(&cam->decimator, (uint64_t)sample_time / 10)) {
+            cam->current_sample = sample;
+            break;
+        }
+        SafeRelease(&sample);   // Decimated: never locked or copied
+    }
+    request_sample(cam);        // The next sample arrives while this one is used
 
     if (SUCCEEDED(cam->current_sample->ConvertToContiguousBuffer(&cam->current_buffer))) {
         BYTE *pData = NULL;
@@ -315,6 +493,8 @@ WEBCAM_API int webcam_capture(Webcam *cam, WebcamFrame *frame) {
         frame->height = cam->actual_height;
         frame->format = cam->format;
         frame->timestamp_ms = GetTickCount64();
+        frame->timestamp_us = arrived_us;
+        frame->control_generation = webcam_controls_at(&cam->controls, frame->timestamp_us);
         
         int pixels = cam->actual_width * cam->actual_height;
         
@@ -329,8 +509,12 @@ WEBCAM_API int webcam_capture(Webcam *cam, WebcamFrame *frame) {
                 frame->size = pixels * 2;
                 break;
             case WEBCAM_FMT_YUV420:
+            case WEBCAM_FMT_NV12:
                 frame->size = pixels * 3 / 2;
                 break;
+            case WEBCAM_FMT_GRAY8:
+                frame->size = pixels;
+                break;
             case WEBCAM_FMT_MJPEG:
                 frame->size = len;
                 break;
@@ -349,6 +533,12 @@ WEBCAM_API void webcam_release_frame(Webcam *cam) {
     }
 }
 
+// Only one sample is held at a time on this backend
+WEBCAM_API void webcam_return_frame(Webcam *cam, const WebcamFrame *frame) {
+    if (!frame) return;
+    webcam_release_frame(cam);
+}
+
 WEBCAM_API void webcam_close(Webcam *cam) {
     if (cam) {
         if (cam->current_buffer) {
@@ -358,7 +548,10 @@ WEBCAM_API void webcam_close(Webcam *cam) {
         SafeRelease(&cam->current_sample);
         SafeRelease(&cam->procAmp);
         SafeRelease(&cam->camControl);
+        if (cam->reader) flush_reader(cam);    // No callback after this
         SafeRelease(&cam->reader);
+        SafeRelease(&cam->callback);
+        webcam_workers_destroy(cam->workers);
         delete cam;
     }
 }
@@ -375,6 +568,76 @@ WEBCAM_API WebcamPixelFormat webcam_get_format(Webcam *cam) {
     return cam ? cam->format : WEBCAM_FMT_YUYV;
 }
 
+WEBCAM_API int webcam_set_threads(Webcam *cam, int threads) {
+    if (!cam) return -1;
+    webcam_workers_destroy(cam->workers);
+    cam->workers = webcam_workers_create(threads);
+    if (threads > 1 && !cam->workers) return -1;
+    if (!cam->rt.cpu_mask && !cam->rt.priority) return 0;
+    return webcam_workers_set_rt(cam->workers, &cam->rt);
+}
+
+// Media Foundation owns the sample memory, so lock_memory has nothing to lock
+WEBCAM_API int webcam_set_rt_profile(Webcam *cam, const WebcamRtProfile *profile) {
+    if (!cam || !profile) return -1;
+    cam->rt = *profile;
+    cam->rt.lock_memory = 0;
+    return webcam_workers_set_rt(cam->workers, &cam->rt);
+}
+
+// Frames carry the read time, not a driver timestamp: nothing to measure
+WEBCAM_API int webcam_get_latency_stats(Webcam *cam, WebcamLatencyStats *stats, int reset) {
+    (void)reset;
+    if (!cam || !stats) return -1;
+    *stats = WebcamLatencyStats();
+    return -1;
+}
+
+WEBCAM_API int webcam_get_threads(Webcam *cam) {
+    return cam ? webcam_workers_count(cam->workers) : 0;
+}
+
+WebcamWorkers* webcam_get_workers(Webcam *cam) {
+    return cam ? cam->workers : NULL;
+}
+
+WebcamControls* webcam_get_controls(Webcam *cam) {
+    return &cam->controls;
+}
+
+WEBCAM_API int webcam_get_fd(Webcam *cam) {
+    return -1;
+}
+
+WEBCAM_API int webcam_set_fps(Webcam *cam, int fps) {
+    if (!cam || !cam->reader || fps <= 0) return -1;
+    IMFMediaType *pType = NULL;
+    if (FAILED(cam->reader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, &pType)))
+        return -1;
+    flush_reader(cam);          // Samples at the old rate are dropped
+    MFSetAttributeRatio(pType, MF_MT_FRAME_RATE, fps, 1);
+    HRESULT hr = cam->reader->SetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, NULL, pType);
+    SafeRelease(&pType);
+    return SUCCEEDED(hr) ? 0 : -1;
+}
+
+WEBCAM_API int webcam_get_fps(Webcam *cam) {
+    if (!cam || !cam->reader) return 0;
+    IMFMediaType *pType = NULL;
+    UINT32 num = 0, den = 0;
+    if (SUCCEEDED(cam->reader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, &pType))) {
+        MFGetAttributeRatio(pType, MF_MT_FRAME_RATE, &num, &den);
+        SafeRelease(&pType);
+    }
+    return den ? (int)((num + den / 2) / den) : 0;
+}
+
+WEBCAM_API int webcam_set_decimation(Webcam *cam, int every_nth, int max_fps) {
+    if (!cam) return -1;
+    webcam_decimator_set(&cam->decimator, every_nth, max_fps);
+    return 0;
+}
+
 static long get_proc_amp(Webcam *cam, long prop) {
     if (!cam->procAmp) return -1;
     long val, f; 
@@ -410,12 +673,21 @@ WEBCAM_API long webcam_get_parameter(Webcam *cam, WebcamParameter param) {
         case WEBCAM_PARAM_EXPOSURE: return get_cam_ctrl(cam, CameraControl_Exposure);
         case WEBCAM_PARAM_FOCUS: return get_cam_ctrl(cam, CameraControl_Focus);
         case WEBCAM_PARAM_ZOOM: return get_cam_ctrl(cam, CameraControl_Zoom);
+        default: break;
     }
     return -1;
 }
 
-WEBCAM_API int webcam_set_parameter(Webcam *cam, WebcamParameter param, long value) {
-    if (!cam) return -1;
+// Runs on whichever thread drains the control queue (webcam_control.c)
+int webcam_apply_control(Webcam *cam, WebcamParameter param, long value, int set_auto) {
+    if (set_auto) {
+        switch(param) {
+            case WEBCAM_PARAM_EXPOSURE: return set_cam_ctrl(cam, CameraControl_Exposure, 0, (int)value);
+            case WEBCAM_PARAM_FOCUS: return set_cam_ctrl(cam, CameraControl_Focus, 0, (int)value);
+            default: break;
+        }
+        return -1;
+    }
     switch(param) {
         case WEBCAM_PARAM_BRIGHTNESS: return set_proc_amp(cam, VideoProcAmp_Brightness, value, 0);
         case WEBCAM_PARAM_CONTRAST: return set_proc_amp(cam, VideoProcAmp_Contrast, value, 0);
@@ -425,15 +697,7 @@ WEBCAM_API int webcam_set_parameter(Webcam *cam, WebcamParameter param, long val
         case WEBCAM_PARAM_EXPOSURE: return set_cam_ctrl(cam, CameraControl_Exposure, value, 0);
         case WEBCAM_PARAM_FOCUS: return set_cam_ctrl(cam, CameraControl_Focus, value, 0);
         case WEBCAM_PARAM_ZOOM: return set_cam_ctrl(cam, CameraControl_Zoom, value, 0);
-    }
-    return -1;
-}
-
-WEBCAM_API int webcam_set_auto(Webcam *cam, WebcamParameter param, int is_auto) {
-    if (!cam) return -1;
-    switch(param) {
-        case WEBCAM_PARAM_EXPOSURE: return set_cam_ctrl(cam, CameraControl_Exposure, 0, is_auto);
-        case WEBCAM_PARAM_FOCUS: return set_cam_ctrl(cam, CameraControl_Focus, 0, is_auto);
+        default: break;
     }
     return -1;
 }
@@ -0,0 +1,297 @@
+// ============================================================================
+// webcam_workers.c - Persistent worker pool for row-parallel transforms
+// ============================================================================
+// A job is split into row bands. Every participant (the calling thread plus
+// the pool threads) starts with a contiguous share of bands, takes them from
+// the front of its own range and, once empty, steals from the back of the
+// others'. Each range is a single 64-bit word (begin << 32 | end) updated by
+// CAS, so owner and thieves never need a lock.
+// ============================================================================
+#include "webcam_internal.h"
+#include "webcam_atomic.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+  typedef HANDLE worker_thread_t;
+  typedef CRITICAL_SECTION worker_mutex_t;
+  typedef CONDITION_VARIABLE worker_cond_t;
+  #define mutex_init(m)       InitializeCriticalSection(m)
+  #define mutex_destroy(m)    DeleteCriticalSection(m)
+  #define mutex_lock(m)       EnterCriticalSection(m)
+  #define mutex_unlock(m)     LeaveCriticalSection(m)
+  #define mutex_trylock(m)    (TryEnterCriticalSection(m) != 0)
+  #define cond_init(c)        InitializeConditionVariable(c)
+  #define cond_destroy(c)     ((void)0)
+  #define cond_wait(c, m)     SleepConditionVariableCS((c), (m), INFINITE)
+  #define cond_broadcast(c)   WakeAllConditionVariable(c)
+  #define cond_signal(c)      WakeConditionVariable(c)
+#else
+  #include <pthread.h>
+  typedef pthread_t worker_thread_t;
+  typedef pthread_mutex_t worker_mutex_t;
+  typedef pthread_cond_t worker_cond_t;
+  #define mutex_init(m)       pthread_mutex_init((m), NULL)
+  #define mutex_destroy(m)    pthread_mutex_destroy(m)
+  #define mutex_lock(m)       pthread_mutex_lock(m)
+  #define mutex_unlock(m)     pthread_mutex_unlock(m)
+  #define mutex_trylock(m)    (pthread_mutex_trylock(m) == 0)
+  #define cond_init(c)        pthread_cond_init((c), NULL)
+  #define cond_destroy(c)     pthread_cond_destroy(c)
+  #define cond_wait(c, m)     pthread_cond_wait((c), (m))
+  #define cond_broadcast(c)   pthread_cond_broadcast(c)
+  #define cond_signal(c)      pthread_cond_signal(c)
+#endif
+
+#define MIN_BAND_ROWS 8
+#define BANDS_PER_THREAD 4
+
+// One cache line per range so owners and thieves don't false-share
+typedef struct {
+    volatile int64_t range;
+    char pad[64 - sizeof(int64_t)];
+} WorkRange;
+
+typedef struct {
+    WebcamWorkers *pool;
+    int id;
+} WorkerArg;
+
+struct WebcamWorkers {
+    int count;                  // Participants, including the calling thread
+    worker_thread_t *threads;
+    WorkerArg *args;
+    WorkRange *ranges;
+    worker_mutex_t submit;      // Held by the thread whose job is in the pool
+    worker_mutex_t lock;
+    worker_cond_t start;
+    worker_cond_t done;
+    unsigned long generation;
+    int finished;
+    int quit;
+
+    // Real-time profile each thread applies to itself
+    WebcamRtProfile rt;
+    unsigned long rt_serial;
+    int rt_done;
+    int rt_failed;
+
+    // Current job
+    WebcamRowFn fn;
+    void *ctx;
+    int rows;
+    int band_rows;
+};
+
+static int64_t pack_range(int begin, int end) {
+    return (int64_t)(((uint64_t)(uint32_t)begin << 32) | (uint32_t)end);
+}
+
+static int range_begin(int64_t r) { return (int)(uint32_t)((uint64_t)r >> 32); }
+static int range_end(int64_t r) { return (int)(uint32_t)((uint64_t)r & 0xFFFFFFFFu); }
+
+static int take_front(WorkRange *q) {
+    int64_t r = atomic_load_64(&q->range);
+    for (;;) {
+        int b = range_begin(r), e = range_end(r);
+        if (b >= e) return -1;
+        if (atomic_cas_64(&q->range, &r, pack_range(b + 1, e))) return b;
+    }
+}
+
+static int steal_back(WorkRange *q) {
+    int64_t r = atomic_load_64(&q->range);
+    for (;;) {
+        int b = range_begin(r), e = range_end(r);
+        if (b >= e) return -1;
+        if (atomic_cas_64(&q->range, &r, pack_range(b, e - 1))) return e - 1;
+    }
+}
+
+static void run_bands(WebcamWorkers *pool, int id) {
+    for (;;) {
+        int band = take_front(&pool->ranges[id]);
+        for (int k = 1; band < 0 && k < pool->count; k++)
+            band = steal_back(&pool->ranges[(id + k) % pool->count]);
+        if (band < 0) return;
+
+        int begin = band * pool->band_rows;
+        int end = begin + pool->band_rows;
+        if (end > pool->rows) end = pool->rows;
+        pool->fn(pool->ctx, begin, end);
+    }
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI worker_main(LPVOID param)
+#else
+static void* worker_main(void *param)
+#endif
+{
+    WorkerArg *arg = (WorkerArg*)param;
+    WebcamWorkers *pool = arg->pool;
+    unsigned long seen = 0, seen_rt = 0;
+
+    for (;;) {
+        mutex_lock(&pool->lock);
+        while (pool->generation == seen && pool->rt_serial == seen_rt && !pool->quit)
+            cond_wait(&pool->start, &pool->lock);
+        if (pool->quit) {
+            mutex_unlock(&pool->lock);
+            break;
+        }
+        if (pool->rt_serial != seen_rt) {
+            WebcamRtProfile rt = pool->rt;
+            seen_rt = pool->rt_serial;
+            mutex_unlock(&pool->lock);
+
+            int r = webcam_rt_apply_self(&rt, arg->id - 1);
+
+            mutex_lock(&pool->lock);
+            if (r != 0) pool->rt_failed = 1;
+            if (++pool->rt_done == pool->count - 1) cond_broadcast(&pool->done);
+            mutex_unlock(&pool->lock);
+            continue;
+        }
+        seen = pool->generation;
+        mutex_unlock(&pool->lock);
+
+        run_bands(pool, arg->id);
+
+        mutex_lock(&pool->lock);
+        // Broadcast: webcam_workers_set_rt() may be waiting on done as well
+        if (++pool->finished == pool->count - 1) cond_broadcast(&pool->done);
+        mutex_unlock(&pool->lock);
+    }
+    return 0;
+}
+
+WebcamWorkers* webcam_workers_create(int threads) {
+    if (threads < 2) return NULL;
+
+    WebcamWorkers *pool = (WebcamWorkers*)calloc(1, sizeof(WebcamWorkers));
+    if (!pool) return NULL;
+
+    pool->count = threads;
+    pool->threads = (worker_thread_t*)calloc(threads, sizeof(worker_thread_t));
+    pool->args = (WorkerArg*)calloc(threads, sizeof(WorkerArg));
+    pool->ranges = (WorkRange*)calloc(threads, sizeof(WorkRange));
+    if (!pool->threads || !pool->args || !pool->ranges) {
+        free(pool->threads);
+        free(pool->args);
+        free(pool->ranges);
+        free(pool);
+        return NULL;
+    }
+
+    mutex_init(&pool->submit);
+    mutex_init(&pool->lock);
+    cond_init(&pool->start);
+    cond_init(&pool->done);
+
+    // Participant 0 is whoever calls webcam_parallel_rows()
+    for (int i = 1; i < threads; i++) {
+        pool->args[i].pool = pool;
+        pool->args[i].id = i;
+#if defined(_WIN32)
+        pool->threads[i] = CreateThread(NULL, 0, worker_main, &pool->args[i], 0, NULL);
+        int failed = (pool->threads[i] == NULL);
+#else
+        int failed = pthread_create(&pool->threads[i], NULL, worker_main, &pool->args[i]) != 0;
+#endif
+        if (failed) {
+            pool->count = i;
+            webcam_workers_destroy(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void webcam_workers_destroy(WebcamWorkers *pool) {
+    if (!pool) return;
+
+    mutex_lock(&pool->lock);
+    pool->quit = 1;
+    cond_broadcast(&pool->start);
+    mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->count; i++) {
+#if defined(_WIN32)
+        WaitForSingleObject(pool->threads[i], INFINITE);
+        CloseHandle(pool->threads[i]);
+#else
+        pthread_join(pool->threads[i], NULL);
+#endif
+    }
+
+    cond_destroy(&pool->start);
+    cond_destroy(&pool->done);
+    mutex_destroy(&pool->lock);
+    mutex_destroy(&pool->submit);
+    free(pool->threads);
+    free(pool->args);
+    free(pool->ranges);
+    free(pool);
+}
+
+int webcam_workers_set_rt(WebcamWorkers *pool, const WebcamRtProfile *profile) {
+    if (!pool) return 0;
+
+    mutex_lock(&pool->lock);
+    pool->rt = *profile;
+    pool->rt_done = 0;
+    pool->rt_failed = 0;
+    pool->rt_serial++;
+    cond_broadcast(&pool->start);
+    while (pool->rt_done < pool->count - 1)
+        cond_wait(&pool->done, &pool->lock);
+    int r = pool->rt_failed ? -1 : 0;
+    mutex_unlock(&pool->lock);
+    return r;
+}
+
+int webcam_workers_count(WebcamWorkers *pool) {
+    return pool ? pool->count : 1;
+}
+
+void webcam_parallel_rows(WebcamWorkers *pool, int rows, WebcamRowFn fn, void *ctx) {
+    if (rows <= 0) return;
+    // Another thread's job owns the pool: run this one inline rather than
+    // queue behind it (the output does not depend on the thread count)
+    if (!pool || rows < 2 * MIN_BAND_ROWS || !mutex_trylock(&pool->submit)) {
+        fn(ctx, 0, rows);
+        return;
+    }
+
+    int band_rows = rows / (pool->count * BANDS_PER_THREAD);
+    if (band_rows < MIN_BAND_ROWS) band_rows = MIN_BAND_ROWS;
+    int bands = (rows + band_rows - 1) / band_rows;
+
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->rows = rows;
+    pool->band_rows = band_rows;
+    for (int i = 0; i < pool->count; i++) {
+        int b = (int)((long long)bands * i / pool->count);
+        int e = (int)((long long)bands * (i + 1) / pool->count);
+        pool->ranges[i].range = pack_range(b, e);
+    }
+
+    mutex_lock(&pool->lock);
+    pool->finished = 0;
+    pool->generation++;
+    cond_broadcast(&pool->start);
+    mutex_unlock(&pool->lock);
+
+    run_bands(pool, 0);
+
+    // Wait for every worker, not just every band, so none is still reading
+    // this job when the next one is set up
+    mutex_lock(&pool->lock);
+    while (pool->finished < pool->count - 1)
+        cond_wait(&pool->done, &pool->lock);
+    mutex_unlock(&pool->lock);
+    mutex_unlock(&pool->submit);
+}